@@ -0,0 +1,123 @@
+/* Generated by converter.py --codegen from test_grammar.json. Do not edit. */
+
+#include "../include/fuzzer/fuzzer.h"
+
+#if TOKEN_BITS != 8
+#error "This grammar was generated for TOKEN_BITS=8"
+#endif
+
+static int gen_0_start(Rng* rng, TokenArray* fuzzed);
+static int gen_1_sentence(Rng* rng, TokenArray* fuzzed);
+static int gen_2_noun_phrase(Rng* rng, TokenArray* fuzzed);
+static int gen_3_verb(Rng* rng, TokenArray* fuzzed);
+static int gen_4_article(Rng* rng, TokenArray* fuzzed);
+static int gen_5_noun(Rng* rng, TokenArray* fuzzed);
+
+// <start>
+static int gen_0_start(Rng* rng, TokenArray* fuzzed)
+{
+	// <start> ::= <sentence>
+	if (gen_1_sentence(rng, fuzzed) != 0) return -1;
+	return 0;
+}
+
+// <sentence>
+static int gen_1_sentence(Rng* rng, TokenArray* fuzzed)
+{
+	// <sentence> ::= <noun_phrase> <verb>
+	if (gen_2_noun_phrase(rng, fuzzed) != 0) return -1;
+	if (gen_3_verb(rng, fuzzed) != 0) return -1;
+	return 0;
+}
+
+// <noun_phrase>
+static int gen_2_noun_phrase(Rng* rng, TokenArray* fuzzed)
+{
+	// <noun_phrase> ::= <article> <noun>
+	if (gen_4_article(rng, fuzzed) != 0) return -1;
+	if (gen_5_noun(rng, fuzzed) != 0) return -1;
+	return 0;
+}
+
+// <verb>
+static int gen_3_verb(Rng* rng, TokenArray* fuzzed)
+{
+	switch (rng_bounded(rng, 3))
+	{
+	case 0:	// <verb> ::= stands
+		if (token_array_push(fuzzed, 0x5) != 0) return -1;	// stands
+		break;
+	case 1:	// <verb> ::= walks
+		if (token_array_push(fuzzed, 0x6) != 0) return -1;	// walks
+		break;
+	case 2:	// <verb> ::= jumps
+		if (token_array_push(fuzzed, 0x7) != 0) return -1;	// jumps
+		break;
+	}
+	return 0;
+}
+
+// <article>
+static int gen_4_article(Rng* rng, TokenArray* fuzzed)
+{
+	switch (rng_bounded(rng, 2))
+	{
+	case 0:	// <article> ::= a
+		if (token_array_push(fuzzed, 0x3) != 0) return -1;	// a
+		break;
+	case 1:	// <article> ::= the
+		if (token_array_push(fuzzed, 0x4) != 0) return -1;	// the
+		break;
+	}
+	return 0;
+}
+
+// <noun>
+static int gen_5_noun(Rng* rng, TokenArray* fuzzed)
+{
+	switch (rng_bounded(rng, 3))
+	{
+	case 0:	// <noun> ::= horse
+		if (token_array_push(fuzzed, 0x0) != 0) return -1;	// horse
+		break;
+	case 1:	// <noun> ::= dog
+		if (token_array_push(fuzzed, 0x1) != 0) return -1;	// dog
+		break;
+	case 2:	// <noun> ::= hamster
+		if (token_array_push(fuzzed, 0x2) != 0) return -1;	// hamster
+		break;
+	}
+	return 0;
+}
+
+int unify_key_inv_gen(Token key, Rng* rng, TokenArray* fuzzed)
+{
+	int ret;
+	switch (key)
+	{
+	case 0x80:
+		ret = gen_0_start(rng, fuzzed);
+		break;
+	case 0x81:
+		ret = gen_1_sentence(rng, fuzzed);
+		break;
+	case 0x82:
+		ret = gen_2_noun_phrase(rng, fuzzed);
+		break;
+	case 0x83:
+		ret = gen_3_verb(rng, fuzzed);
+		break;
+	case 0x84:
+		ret = gen_4_article(rng, fuzzed);
+		break;
+	case 0x85:
+		ret = gen_5_noun(rng, fuzzed);
+		break;
+	default:
+		// The only string which a terminal symbol can generate is
+		// the symbol itself.
+		ret = token_array_push(fuzzed, key);
+		break;
+	}
+	return ret != 0 ? ret : flush_token_array(fuzzed);
+}
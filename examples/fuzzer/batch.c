@@ -0,0 +1,44 @@
+#include "../../include/grammar.h"
+#include "../../include/grammar_file.h"
+#include "../../include/fuzzer/fuzzer.h"
+
+#define GRAMMAR_PATH "data/grammar.bin"
+#define START_TOKEN NON_TERMINAL(0)
+#define BATCH_SIZE 8
+
+int main(int argc, char* argv[]) 
+{
+    // Setup
+    GrammarFile gf;
+    if (load_grammar_file(&gf, argc > 1 ? argv[1] : GRAMMAR_PATH) != 0)
+        return 1;
+
+    Fuzzer fuzzer;
+    FuzzBatch batch;
+    if (init_fuzzer(&fuzzer, &gf.grammar, (uint64_t) time(NULL)) != 0
+        || init_fuzz_batch(&batch, BATCH_SIZE, 0) != 0)
+        return 1;
+
+    // Use
+    if (fuzz_batch(START_TOKEN, BATCH_SIZE, &fuzzer, &batch) != 0)
+        return 1;
+
+    printf("Generated %zu strings in %zu tokens\n", 
+        batch.num_strings, batch.tokens.index);
+    for (size_t i = 0; i < batch.num_strings; i++)
+    {
+        const Token* string = fuzz_batch_string(&batch, i);
+        for (size_t j = 0; j < fuzz_batch_length(&batch, i); j++)
+        {
+            printf("%s ", grammar_file_token_str(&gf, string[j]));
+        }
+        printf("\n");
+    }
+
+    // Cleanup
+    breakdown_fuzz_batch(&batch);
+    breakdown_fuzzer(&fuzzer);
+    unload_grammar_file(&gf);
+
+    return 0;
+}
@@ -0,0 +1,60 @@
+#include "../../include/grammar.h"
+#include "../../include/grammar_file.h"
+#include "../../include/fuzzer/fuzzer.h"
+
+#define GRAMMAR_PATH "data/grammar.bin"
+#define START_TOKEN NON_TERMINAL(0)
+#define BYTE_BUDGET 14
+#define NUM_STRINGS 8
+
+/*
+ * Usage: ./bin/fuzzer_budget.o [grammar file] [budget in bytes]
+ */
+int main(int argc, char* argv[]) 
+{
+    // Setup
+    GrammarFile gf;
+    if (load_grammar_file(&gf, argc > 1 ? argv[1] : GRAMMAR_PATH) != 0)
+        return 1;
+
+    size_t budget = argc > 2 ? strtoul(argv[2], NULL, 10) : BYTE_BUDGET;
+
+    // Cost each terminal by the length of its string to budget in bytes.
+    MinCostTable costs;
+    if (init_min_cost_table(&costs, &gf.grammar, gf.terminal_lengths, 
+            gf.num_terminals) != 0)
+        return 1;
+
+    Fuzzer fuzzer;
+    TokenArray fuzzed;
+    if (init_fuzzer(&fuzzer, &gf.grammar, (uint64_t) time(NULL)) != 0
+        || init_token_array(&fuzzed, 0) != 0)
+        return 1;
+    fuzzer_set_budget(&fuzzer, &costs, budget);
+
+    // Use
+    printf("Cheapest string: %zu bytes, budget: %zu bytes\n", 
+        key_min_cost(&costs, START_TOKEN), budget);
+    for (size_t i = 0; i < NUM_STRINGS; i++)
+    {
+        clear_token_array(&fuzzed);
+        if (unify_key_inv(START_TOKEN, &fuzzer, &fuzzed) != 0)
+            return 1;
+
+        size_t length = 0;
+        for (size_t j = 0; j < fuzzed.index; j++)
+        {
+            printf("%s ", grammar_file_token_str(&gf, fuzzed.tokens[j]));
+            length += gf.terminal_lengths[fuzzed.tokens[j]];
+        }
+        printf("(%zu bytes)\n", length);
+    }
+
+    // Cleanup
+    breakdown_token_array(&fuzzed);
+    breakdown_fuzzer(&fuzzer);
+    breakdown_min_cost_table(&costs);
+    unload_grammar_file(&gf);
+
+    return 0;
+}
@@ -0,0 +1,26 @@
+#include "../../include/grammar.h"
+#include "../../include/fuzzer/fuzzer.h"
+
+/* 
+ * The grammar is compiled in through data/grammar_gen.c, which was written by
+ * `python3 ./src/fuzzer/converter.py data/test_grammar.json --codegen`.
+ */
+
+#define START_TOKEN NON_TERMINAL(0)
+
+int main() 
+{
+    Rng rng;
+    rng_seed(&rng, (uint64_t) time(NULL));
+
+    TokenArray fuzzed;
+    if (init_token_array(&fuzzed, 0) != 0)
+        return 1;
+
+    unify_key_inv_gen(START_TOKEN, &rng, &fuzzed);
+    print_token_array(&fuzzed);
+
+    breakdown_token_array(&fuzzed);
+
+    return 0;
+}
\ No newline at end of file
@@ -0,0 +1,61 @@
+#include "../../include/grammar.h"
+#include "../../include/grammar_file.h"
+#include "../../include/fuzzer/fuzzer.h"
+
+#define GRAMMAR_PATH "data/grammar.bin"
+#define START_TOKEN NON_TERMINAL(0)
+#define NUM_EPOCHS 5
+#define STRINGS_PER_EPOCH 4
+
+int main(int argc, char* argv[]) 
+{
+    // Setup
+    GrammarFile gf;
+    if (load_grammar_file(&gf, argc > 1 ? argv[1] : GRAMMAR_PATH) != 0)
+        return 1;
+
+    // `epoch` holds the hits since the weights were last biased, `campaign`
+    // holds every hit so far.
+    RuleCoverage epoch, campaign;
+    RuleWeights weights;
+    Fuzzer fuzzer;
+    TokenArray fuzzed;
+    if (init_rule_coverage(&epoch, &gf.grammar) != 0
+        || init_rule_coverage(&campaign, &gf.grammar) != 0
+        || init_rule_weights(&weights, &gf.grammar, gf.rule_weights) != 0
+        || init_fuzzer(&fuzzer, &gf.grammar, (uint64_t) time(NULL)) != 0
+        || init_token_array(&fuzzed, 0) != 0)
+        return 1;
+    fuzzer_set_weights(&fuzzer, &weights);
+    fuzzer_set_coverage(&fuzzer, &epoch);
+
+    // Use
+    for (size_t i = 0; i < NUM_EPOCHS; i++)
+    {
+        for (size_t j = 0; j < STRINGS_PER_EPOCH; j++)
+        {
+            clear_token_array(&fuzzed);
+            unify_key_inv(START_TOKEN, &fuzzer, &fuzzed);
+        }
+
+        // Favour the rules used least in this epoch during the next one.
+        bias_rule_weights(&epoch, gf.rule_weights, &weights);
+        merge_rule_coverage(&campaign, &epoch);
+        clear_rule_coverage(&epoch);
+
+        printf("Epoch %zu: %zu of %zu rules covered\n", i + 1, 
+            rule_coverage_count(&campaign), gf.grammar.num_rules);
+    }
+
+    write_rule_coverage(&campaign, &gf, stdout);
+
+    // Cleanup
+    breakdown_token_array(&fuzzed);
+    breakdown_fuzzer(&fuzzer);
+    breakdown_rule_weights(&weights);
+    breakdown_rule_coverage(&campaign);
+    breakdown_rule_coverage(&epoch);
+    unload_grammar_file(&gf);
+
+    return 0;
+}
@@ -0,0 +1,48 @@
+#include "../../include/grammar.h"
+#include "../../include/grammar_file.h"
+#include "../../include/fuzzer/fuzzer.h"
+
+#include <string.h>
+
+#define GRAMMAR_PATH "data/grammar.bin"
+#define START_TOKEN NON_TERMINAL(0)
+
+int main(int argc, char* argv[]) 
+{
+    // Setup
+    GrammarFile gf;
+    if (load_grammar_file(&gf, argc > 1 ? argv[1] : GRAMMAR_PATH) != 0)
+        return 1;
+
+    Fuzzer fuzzer;
+    DerivationTree tree;
+    TokenArray fuzzed, replayed;
+    if (init_fuzzer(&fuzzer, &gf.grammar, (uint64_t) time(NULL)) != 0
+        || init_derivation_tree(&tree, &gf.grammar, 0) != 0
+        || init_token_array(&fuzzed, 0) != 0
+        || init_token_array(&replayed, 0) != 0)
+        return 1;
+    fuzzer_set_derivation(&fuzzer, &tree);
+
+    // Use
+    if (unify_key_inv(START_TOKEN, &fuzzer, &fuzzed) != 0)
+        return 1;
+    print_token_array(&fuzzed);
+    write_derivation_tree(&tree, &gf, stdout);
+
+    // The tree alone is enough to generate the same string again.
+    if (derivation_tree_string(&tree, &replayed) != 0)
+        return 1;
+    int same = replayed.index == fuzzed.index
+        && memcmp(replayed.tokens, fuzzed.tokens, fuzzed.index * sizeof(Token)) == 0;
+    printf("%u nodes, replayed %s\n", tree.num_nodes, same ? "identically" : "differently");
+
+    // Cleanup
+    breakdown_token_array(&replayed);
+    breakdown_token_array(&fuzzed);
+    breakdown_derivation_tree(&tree);
+    breakdown_fuzzer(&fuzzer);
+    unload_grammar_file(&gf);
+
+    return 0;
+}
@@ -2,103 +2,73 @@
 #include "../../include/fuzzer/fuzzer.h"
 
 /* data/test_grammar.txt */
+#if TOKEN_BITS != 8
+#error "This grammar was generated for TOKEN_BITS=8"
+#endif
+
+static const Token GRAMMAR_TOKENS[] = {
+    // <start> ::= <sentence>
+    0x81,
+    // <sentence> ::= <noun_phrase> <verb>
+    0x82, 0x83,
+    // <noun_phrase> ::= <article> <noun>
+    0x84, 0x85,
+    // <verb> ::= stands
+    0x5,
+    // <verb> ::= walks
+    0x6,
+    // <verb> ::= jumps
+    0x7,
+    // <article> ::= a
+    0x3,
+    // <article> ::= the
+    0x4,
+    // <noun> ::= horse
+    0x0,
+    // <noun> ::= dog
+    0x1,
+    // <noun> ::= hamster
+    0x2
+};
+
+static const uint32_t GRAMMAR_TOKEN_OFFSETS[] = {0, 1, 3, 5, 6, 7, 8, 9, 10, 11, 12, 13};
+
+static const uint32_t GRAMMAR_RULE_OFFSETS[] = {
+    0,    // <start>
+    1,    // <sentence>
+    2,    // <noun_phrase>
+    3,    // <verb>
+    6,    // <article>
+    8,    // <noun>
+    11
+};
+
 Grammar GRAMMAR = {
-    6,
-    {
-        {
-            0x80,
-            1,
-            {
-                {
-                    1, 
-                    {0x81}
-                }
-            }
-        },
-        {
-            0x81,
-            1,
-            {
-                {
-                    2,
-                    {0x82, 0x83}
-                }
-            }
-        },
-        {
-            0x82,
-            1,
-            {
-                {
-                    2,
-                    {0x84, 0x85}
-                }
-            }
-        },
-        {
-            0x83,
-            3,
-            {
-                {
-                    1,
-                    {0x05}
-                },
-                {
-                    1,
-                    {0x06}
-                },
-                {
-                    1,
-                    {0x07}
-                }
-            }
-        },
-        {
-            0x84,
-            2,
-            {
-                {
-                    1,
-                    {0x03}
-                },
-                {
-                    1,
-                    {0x04}
-                }
-            }
-        },
-        {
-            0x85,
-            3,
-            {
-                {
-                    1,
-                    {0x00}
-                },
-                {
-                    1,
-                    {0x01}
-                },
-                {
-                    1,
-                    {0x02}
-                }
-            }
-        }
-    }
+    6,    // Number of non-terminals
+    11,    // Number of rules
+    13,    // Number of tokens
+    GRAMMAR_RULE_OFFSETS,
+    GRAMMAR_TOKEN_OFFSETS,
+    GRAMMAR_TOKENS
 };
 
-#define START_TOKEN 0x80
+#define START_TOKEN NON_TERMINAL(0)
 
 int main() 
 {
-    srand((unsigned int)time(NULL));
+    Fuzzer fuzzer;
+    if (init_fuzzer(&fuzzer, &GRAMMAR, (uint64_t) time(NULL)) != 0)
+        return 1;
 
     TokenArray fuzzed;
-    fuzzed.index = 0;
+    if (init_token_array(&fuzzed, 0) != 0)
+        return 1;
 
-    unify_key_inv(START_TOKEN, &GRAMMAR, &fuzzed);
+    unify_key_inv(START_TOKEN, &fuzzer, &fuzzed);
     print_token_array(&fuzzed);
 
+    breakdown_token_array(&fuzzed);
+    breakdown_fuzzer(&fuzzer);
+
     return 0;
 }
\ No newline at end of file
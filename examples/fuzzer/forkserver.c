@@ -0,0 +1,50 @@
+#include "../../include/grammar.h"
+#include "../../include/grammar_file.h"
+#include "../../include/fuzzer/harness.h"
+
+#define GRAMMAR_PATH "data/grammar.bin"
+#define TARGET_PATH "bin/forkserver_target.o"
+#define START_TOKEN NON_TERMINAL(0)
+#define NUM_EXECS 20000
+#define MAX_INPUT 4096
+
+/*
+ * Usage: ./bin/fuzzer_forkserver.o [grammar file] [crash directory]
+ * Runs ./bin/forkserver_target.o, which must be built first.
+ */
+int main(int argc, char* argv[]) 
+{
+    // Setup
+    GrammarFile gf;
+    if (load_grammar_file(&gf, argc > 1 ? argv[1] : GRAMMAR_PATH) != 0)
+        return 1;
+
+    char* target[] = {TARGET_PATH, NULL};
+    ForkServer server;
+    if (init_fork_server(&server, target, MAX_INPUT, 1000) != 0)
+        return 1;
+
+    Fuzzer fuzzer;
+    Harness harness;
+    if (init_fuzzer(&fuzzer, &gf.grammar, (uint64_t) time(NULL)) != 0
+        || init_harness(&harness, &gf, &fuzzer, NULL, argc > 2 ? argv[2] : NULL) != 0)
+        return 1;
+    harness.server = &server;
+    harness.timeout_ms = 1000;
+    harness.report_interval = 1;
+
+    // Use
+    if (run_harness(&harness, START_TOKEN, NUM_EXECS) != 0)
+        return 1;
+    printf("%zu execs in %.3fs: %.0f execs/s, %zu crashes, %zu timeouts\n",
+        harness.execs, harness.seconds, harness.execs / harness.seconds,
+        harness.crashes, harness.timeouts);
+
+    // Cleanup
+    breakdown_harness(&harness);
+    breakdown_fuzzer(&fuzzer);
+    breakdown_fork_server(&server);
+    unload_grammar_file(&gf);
+
+    return 0;
+}
@@ -0,0 +1,36 @@
+#include "../../include/fuzzer/forkserver.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define MAX_INPUT 4096
+
+/*
+ * A standalone target for ./bin/fuzzer_forkserver.o. It aborts on "the
+ * hamster jumps" and exits with 1 on "a hamster jumps". Run by hand, it reads
+ * its input from stdin.
+ */
+int main(void)
+{
+    static uint8_t buffer[MAX_INPUT];
+    const uint8_t* data;
+    size_t size;
+
+    // Everything above this line is only done once, not once per input.
+    if (forkserver_start(&data, &size) != 0)
+    {
+        size = fread(buffer, 1, sizeof(buffer), stdin);
+        data = buffer;
+    }
+
+    static const char bug[] = "hamsterjumps";
+    size_t bug_len = sizeof(bug) - 1;
+    if (size < bug_len || memcmp(data + size - bug_len, bug, bug_len) != 0)
+        return 0;
+    if (size >= bug_len + 3 && memcmp(data + size - bug_len - 3, "the", 3) == 0)
+        abort();
+    if (size >= bug_len + 1 && data[size - bug_len - 1] == 'a')
+        return 1;
+    return 0;
+}
@@ -0,0 +1,52 @@
+#include "../../include/grammar.h"
+#include "../../include/grammar_file.h"
+#include "../../include/fuzzer/harness.h"
+
+#include <string.h>
+
+#define GRAMMAR_PATH "data/grammar.bin"
+#define START_TOKEN NON_TERMINAL(0)
+#define NUM_EXECS 10000000
+
+// A stand-in for the code under test, with a bug: it rejects "the
+// hamster jumps".
+static int target(const uint8_t* data, size_t size)
+{
+    static const char bug[] = "thehamsterjumps";
+    size_t bug_len = sizeof(bug) - 1;
+    return size >= bug_len && memcmp(data + size - bug_len, bug, bug_len) == 0;
+}
+
+/*
+ * Usage: ./bin/fuzzer_harness.o [grammar file] [crash directory]
+ * Without a crash directory, failing inputs are counted but not saved.
+ */
+int main(int argc, char* argv[]) 
+{
+    // Setup
+    GrammarFile gf;
+    if (load_grammar_file(&gf, argc > 1 ? argv[1] : GRAMMAR_PATH) != 0)
+        return 1;
+
+    Fuzzer fuzzer;
+    Harness harness;
+    if (init_fuzzer(&fuzzer, &gf.grammar, (uint64_t) time(NULL)) != 0
+        || init_harness(&harness, &gf, &fuzzer, target, argc > 2 ? argv[2] : NULL) != 0)
+        return 1;
+    harness.timeout_ms = 1000;
+    harness.report_interval = 1;
+
+    // Use
+    if (run_harness(&harness, START_TOKEN, NUM_EXECS) != 0)
+        return 1;
+    printf("%zu execs in %.3fs: %.0f execs/s, %zu crashes, %zu timeouts\n",
+        harness.execs, harness.seconds, harness.execs / harness.seconds,
+        harness.crashes, harness.timeouts);
+
+    // Cleanup
+    breakdown_harness(&harness);
+    breakdown_fuzzer(&fuzzer);
+    unload_grammar_file(&gf);
+
+    return 0;
+}
@@ -0,0 +1,113 @@
+#include "../../include/grammar.h"
+#include "../../include/grammar_file.h"
+#include "../../include/fuzzer/fuzzer.h"
+#include "../../include/fuzzer/minimise.h"
+
+#include <string.h>
+
+#define GRAMMAR_PATH "data/grammar.bin"
+#define START_TOKEN NON_TERMINAL(0)
+#define BUDGET 64
+#define MAX_ATTEMPTS 1000
+
+// Stands in for running a target: a string is "interesting" if it still
+// contains the token which `ctx` points to.
+static int contains_token(const Token* tokens, size_t num_tokens, void* ctx)
+{
+    Token wanted = *(const Token*) ctx;
+    for (size_t i = 0; i < num_tokens; i++)
+    {
+        if (tokens[i] == wanted)
+            return 1;
+    }
+    return 0;
+}
+
+// Returns the terminal whose string is `str`, or -1 if there is none.
+static long find_terminal(const GrammarFile* gf, const char* str)
+{
+    for (size_t i = 0; i < gf->num_terminals; i++)
+    {
+        if (strcmp(grammar_file_token_str(gf, i), str) == 0)
+            return (long) i;
+    }
+    return -1;
+}
+
+static void print_string(const GrammarFile* gf, const Token* tokens, size_t num_tokens)
+{
+    for (size_t i = 0; i < num_tokens; i++)
+    {
+        write_grammar_file_token(gf, tokens[i], stdout);
+        putchar(' ');
+    }
+    putchar('\n');
+}
+
+int main(int argc, char* argv[]) 
+{
+    // Setup
+    GrammarFile gf;
+    if (load_grammar_file(&gf, argc > 1 ? argv[1] : GRAMMAR_PATH) != 0)
+        return 1;
+
+    Fuzzer fuzzer;
+    MinCostTable costs;
+    DerivationTree tree;
+    TokenArray fuzzed;
+    if (init_fuzzer(&fuzzer, &gf.grammar, (uint64_t) time(NULL)) != 0
+        || init_min_cost_table(&costs, &gf.grammar, NULL, 0) != 0
+        || init_derivation_tree(&tree, &gf.grammar, 0) != 0
+        || init_token_array(&fuzzed, 0) != 0)
+        return 1;
+    fuzzer_set_budget(&fuzzer, &costs, BUDGET);
+    fuzzer_set_derivation(&fuzzer, &tree);
+
+    // Use
+    // Keep the terminal named by the second argument, e.g., `7` with
+    // data/decimal_grammar.json, otherwise the last token of the string.
+    Token wanted = 0;
+    if (argc > 2)
+    {
+        long terminal = find_terminal(&gf, argv[2]);
+        if (terminal < 0)
+        {
+            fprintf(stderr, "No terminal \"%s\" in the grammar\n", argv[2]);
+            return 1;
+        }
+        wanted = (Token) terminal;
+    }
+
+    size_t attempts = 0;
+    do
+    {
+        clear_token_array(&fuzzed);
+        if (unify_key_inv(START_TOKEN, &fuzzer, &fuzzed) != 0 || ++attempts > MAX_ATTEMPTS)
+            return 1;
+    } while (fuzzed.index == 0
+        || (argc > 2 && !contains_token(fuzzed.tokens, fuzzed.index, &wanted)));
+    if (argc <= 2)
+        wanted = fuzzed.tokens[fuzzed.index - 1];
+
+    Minimiser minimiser;
+    if (init_minimiser(&minimiser, &gf.grammar, contains_token, &wanted) != 0
+        || minimise(&minimiser, &tree) != 0)
+        return 1;
+
+    printf("Keeping \"%s\"\n", grammar_file_token_str(&gf, wanted));
+    printf("Before (%zu tokens): ", fuzzed.index);
+    print_string(&gf, fuzzed.tokens, fuzzed.index);
+    printf("After (%zu tokens): ", minimiser.tokens.index);
+    print_string(&gf, minimiser.tokens.tokens, minimiser.tokens.index);
+    printf("%zu tests\n", minimiser.num_tests);
+
+    // Cleanup
+    breakdown_minimiser(&minimiser);
+    breakdown_token_array(&fuzzed);
+    breakdown_derivation_tree(&tree);
+    breakdown_min_cost_table(&costs);
+    breakdown_fuzzer(&fuzzer);
+    unload_grammar_file(&gf);
+
+    return 0;
+}
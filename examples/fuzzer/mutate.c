@@ -0,0 +1,92 @@
+#include "../../include/grammar.h"
+#include "../../include/grammar_file.h"
+#include "../../include/fuzzer/mutator.h"
+
+#define GRAMMAR_PATH "data/grammar.bin"
+#define START_TOKEN NON_TERMINAL(0)
+#define CORPUS_SIZE 8
+#define NUM_MUTANTS 1000000
+
+static const char* MUTATION_NAMES[] = {"any", "regenerate", "splice", "recurse"};
+
+static double seconds_since(const struct timespec* start)
+{
+    struct timespec end;
+    clock_gettime(CLOCK_MONOTONIC, &end);
+    return (end.tv_sec - start->tv_sec) + (end.tv_nsec - start->tv_nsec) / 1e9;
+}
+
+int main(int argc, char* argv[]) 
+{
+    // Setup
+    GrammarFile gf;
+    if (load_grammar_file(&gf, argc > 1 ? argv[1] : GRAMMAR_PATH) != 0)
+        return 1;
+
+    Fuzzer fuzzer;
+    DerivationTree tree;
+    TokenArray fuzzed;
+    Corpus corpus;
+    Mutator mutator;
+    if (init_fuzzer(&fuzzer, &gf.grammar, (uint64_t) time(NULL)) != 0
+        || init_derivation_tree(&tree, &gf.grammar, 0) != 0
+        || init_token_array(&fuzzed, 0) != 0
+        || init_corpus(&corpus, &gf.grammar) != 0
+        || init_mutator(&mutator, &fuzzer, &corpus, 4) != 0)
+        return 1;
+
+    // Use
+    // Seed the corpus with freshly generated strings and their derivations.
+    fuzzer_set_derivation(&fuzzer, &tree);
+    for (size_t i = 0; i < CORPUS_SIZE; i++)
+    {
+        clear_token_array(&fuzzed);
+        if (unify_key_inv(START_TOKEN, &fuzzer, &fuzzed) != 0
+            || add_corpus_entry(&corpus, &tree) != 0)
+            return 1;
+    }
+    fuzzer_set_derivation(&fuzzer, NULL);
+
+    printf("Entry 0: ");
+    print_token_array(&corpus.entries[0].tokens);
+    for (MutationType type = MUTATE_REGENERATE; type < NUM_MUTATION_TYPES; type++)
+    {
+        printf("%-10s -> ", MUTATION_NAMES[type]);
+        if (mutate(&mutator, 0, type) == 0)
+            print_token_array(&mutator.tokens);
+        else
+            printf("does not apply\n");
+    }
+
+    // Compare the cost of a mutant with that of a new string.
+    struct timespec start;
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    for (size_t i = 0; i < NUM_MUTANTS; i++)
+    {
+        if (mutate(&mutator, i % CORPUS_SIZE, MUTATE_ANY) < 0)
+            return 1;
+    }
+    double mutate_seconds = seconds_since(&start);
+
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    for (size_t i = 0; i < NUM_MUTANTS; i++)
+    {
+        clear_token_array(&fuzzed);
+        if (unify_key_inv(START_TOKEN, &fuzzer, &fuzzed) != 0)
+            return 1;
+    }
+    double generate_seconds = seconds_since(&start);
+
+    printf("%.0f mutants/s, %.0f generated strings/s\n",
+        NUM_MUTANTS / mutate_seconds, NUM_MUTANTS / generate_seconds);
+
+    // Cleanup
+    breakdown_mutator(&mutator);
+    breakdown_corpus(&corpus);
+    breakdown_token_array(&fuzzed);
+    breakdown_derivation_tree(&tree);
+    breakdown_fuzzer(&fuzzer);
+    unload_grammar_file(&gf);
+
+    return 0;
+}
@@ -0,0 +1,49 @@
+#include "../../include/grammar.h"
+#include "../../include/grammar_file.h"
+#include "../../include/grammar_normalise.h"
+#include "../../include/fuzzer/fuzzer.h"
+
+#define GRAMMAR_PATH "data/grammar.bin"
+#define START_TOKEN NON_TERMINAL(0)
+
+int main(int argc, char* argv[]) 
+{
+    // Setup
+    GrammarFile gf;
+    if (load_grammar_file(&gf, argc > 1 ? argv[1] : GRAMMAR_PATH) != 0)
+        return 1;
+
+    NormalisedGrammar ng;
+    if (normalise_grammar(&ng, &gf.grammar, START_TOKEN) != 0)
+        return 1;
+
+    // Use
+    printf("Non-terminals: %zu -> %zu\n", 
+        gf.grammar.num_non_terminals, ng.grammar.num_non_terminals);
+    printf("Rules: %zu -> %zu\n", gf.grammar.num_rules, ng.grammar.num_rules);
+
+    for (size_t i = 0; i < ng.grammar.num_non_terminals; i++)
+    {
+        Token key = original_token(&ng, NON_TERMINAL(i));
+        printf("0x%x is %s\n", NON_TERMINAL(i), grammar_file_token_str(&gf, key));
+    }
+
+    // The start symbol of a normalised grammar is always NON_TERMINAL(0).
+    Fuzzer fuzzer;
+    if (init_fuzzer(&fuzzer, &ng.grammar, (uint64_t) time(NULL)) != 0)
+        return 1;
+
+    TokenArray fuzzed;
+    if (init_token_array(&fuzzed, 0) != 0)
+        return 1;
+    unify_key_inv(NON_TERMINAL(0), &fuzzer, &fuzzed);
+    print_token_array(&fuzzed);
+
+    // Cleanup
+    breakdown_token_array(&fuzzed);
+    breakdown_fuzzer(&fuzzer);
+    breakdown_normalised_grammar(&ng);
+    unload_grammar_file(&gf);
+
+    return 0;
+}
\ No newline at end of file
@@ -0,0 +1,68 @@
+#include "../../include/grammar.h"
+#include "../../include/grammar_file.h"
+#include "../../include/fuzzer/parallel.h"
+
+#define GRAMMAR_PATH "data/grammar.bin"
+#define START_TOKEN NON_TERMINAL(0)
+#define BATCH_SIZE 4096
+#define NUM_BATCHES 2000
+#define MAX_BATCHES_PER_PULL 4
+
+/*
+ * Usage: ./bin/fuzzer_parallel.o [grammar file] [number of threads]
+ * Without a number of threads, one worker is started per online core.
+ */
+int main(int argc, char* argv[]) 
+{
+    // Setup
+    GrammarFile gf;
+    if (load_grammar_file(&gf, argc > 1 ? argv[1] : GRAMMAR_PATH) != 0)
+        return 1;
+
+    size_t num_threads = argc > 2 ? strtoul(argv[2], NULL, 10) : 0;
+
+    struct timespec start, end;
+    clock_gettime(CLOCK_MONOTONIC, &start);
+
+    ParallelFuzzer pf;
+    if (start_parallel_fuzzer(&pf, &gf.grammar, START_TOKEN, num_threads, 
+            BATCH_SIZE, (uint64_t) time(NULL)) != 0)
+        return 1;
+
+    // Use
+    size_t num_strings = 0;
+    size_t num_tokens = 0;
+    for (size_t i = 0; i < NUM_BATCHES;)
+    {
+        FuzzBatch* batches[MAX_BATCHES_PER_PULL];
+        size_t max = NUM_BATCHES - i < MAX_BATCHES_PER_PULL ? NUM_BATCHES - i : MAX_BATCHES_PER_PULL;
+        size_t count = parallel_fuzzer_next_batches(&pf, batches, max);
+        if (count == 0)
+            break;
+        for (size_t j = 0; j < count; j++, i++)
+        {
+            num_strings += batches[j]->num_strings;
+            num_tokens += batches[j]->tokens.index;
+            parallel_fuzzer_release(&pf, batches[j]);
+        }
+    }
+
+    size_t num_workers = pf.num_workers;
+    size_t num_batches = pf.num_batches;
+    RingStats stats;
+    ring_stats(&pf.ready, &stats);
+    stop_parallel_fuzzer(&pf);
+
+    clock_gettime(CLOCK_MONOTONIC, &end);
+    double seconds = (end.tv_sec - start.tv_sec) + (end.tv_nsec - start.tv_nsec) / 1e9;
+
+    printf("%zu threads generated %zu strings (%zu tokens) in %.3fs: %.0f strings/s\n",
+        num_workers, num_strings, num_tokens, seconds, num_strings / seconds);
+    printf("%.1f of %zu batches ready on average, %zu waits for a batch\n",
+        stats.mean_occupancy, num_batches, stats.empty_waits);
+
+    // Cleanup
+    unload_grammar_file(&gf);
+
+    return 0;
+}
@@ -0,0 +1,74 @@
+#include "../../include/grammar.h"
+#include "../../include/grammar_file.h"
+#include "../../include/fuzzer/fuzzer.h"
+
+#define GRAMMAR_PATH "data/grammar.bin"
+#define START_TOKEN NON_TERMINAL(0)
+#define NUM_STRINGS 100000
+
+// Prints how often each terminal appeared in NUM_STRINGS strings.
+static void print_frequencies(GrammarFile* gf, Fuzzer* fuzzer, TokenArray* fuzzed)
+{
+    size_t* counts = calloc(gf->num_terminals, sizeof(size_t));
+    for (size_t i = 0; i < NUM_STRINGS; i++)
+    {
+        clear_token_array(fuzzed);
+        unify_key_inv(START_TOKEN, fuzzer, fuzzed);
+        for (size_t j = 0; j < fuzzed->index; j++)
+        {
+            counts[fuzzed->tokens[j]]++;
+        }
+    }
+
+    for (size_t key = 0; key < gf->num_terminals; key++)
+    {
+        printf("%s: %.3f  ", grammar_file_token_str(gf, key), 
+            (double) counts[key] / NUM_STRINGS);
+    }
+    printf("\n");
+    free(counts);
+}
+
+int main(int argc, char* argv[]) 
+{
+    // Setup
+    GrammarFile gf;
+    if (load_grammar_file(&gf, argc > 1 ? argv[1] : GRAMMAR_PATH) != 0)
+        return 1;
+
+    // The weights given in the JSON grammar, 1 for any rule without one.
+    RuleWeights weights;
+    if (init_rule_weights(&weights, &gf.grammar, gf.rule_weights) != 0)
+        return 1;
+
+    Fuzzer fuzzer;
+    TokenArray fuzzed;
+    if (init_fuzzer(&fuzzer, &gf.grammar, (uint64_t) time(NULL)) != 0
+        || init_token_array(&fuzzed, 0) != 0)
+        return 1;
+    fuzzer_set_weights(&fuzzer, &weights);
+
+    // Use
+    printf("Weights from the grammar file:\n");
+    print_frequencies(&gf, &fuzzer, &fuzzed);
+
+    // Weights can be changed at any time: favour the last rule of every
+    // non-terminal ten to one.
+    for (size_t nt = 0; nt < gf.grammar.num_non_terminals; nt++)
+    {
+        size_t last_rule = grammar_first_rule(&gf.grammar, nt) 
+            + grammar_num_rules(&gf.grammar, nt) - 1;
+        set_rule_weight(&weights, last_rule, 10 * weights.weights[last_rule]);
+    }
+
+    printf("After weighting the last rule of each non-terminal by 10:\n");
+    print_frequencies(&gf, &fuzzer, &fuzzed);
+
+    // Cleanup
+    breakdown_token_array(&fuzzed);
+    breakdown_fuzzer(&fuzzer);
+    breakdown_rule_weights(&weights);
+    unload_grammar_file(&gf);
+
+    return 0;
+}
@@ -0,0 +1,53 @@
+#include "../../include/sampling/sampling.h"
+#include "../../include/sampling/hash.h"
+#include "../../include/sampling/helpers.h"
+#include "../../include/sampling/dense.h"
+#include "../../include/grammar_file.h"
+
+#define GRAMMAR_PATH "data/grammar.bin"
+#define START_TOKEN NON_TERMINAL(0)
+#define L_STR 11
+
+/*
+ * Usage: ./bin/sampling_dense.o [grammar file] [length]
+ */
+int main(int argc, char* argv[])
+{
+    // Setup
+    GrammarFile gf;
+    if (load_grammar_file(&gf, argc > 1 ? argv[1] : GRAMMAR_PATH) != 0)
+        return 1;
+
+    size_t l_str = argc > 2 ? strtoul(argv[2], NULL, 10) : L_STR;
+    GrammarHashTable grammar_hash;
+    init_grammar_hash_table_from_file(&grammar_hash, &gf);
+
+    struct timespec start, end;
+    clock_gettime(CLOCK_MONOTONIC, &start);
+
+    CountTable ct;
+    if (init_count_table(&ct, &gf.grammar, &grammar_hash, l_str) != 0)
+        return 1;
+
+    clock_gettime(CLOCK_MONOTONIC, &end);
+    double seconds = (end.tv_sec - start.tv_sec) + (end.tv_nsec - start.tv_nsec) / 1e9;
+
+    // Use
+    uint64_t count = count_table_count(&ct, START_TOKEN, l_str);
+    printf("Total number of strings in grammar of length %zu: %llu (counted in %.3fs)\n",
+        l_str, (unsigned long long) count, seconds);
+
+    Rng rng;
+    rng_seed(&rng, (uint64_t) time(NULL));
+    DynTokenArray* string = count_table_sample_UAR(&ct, START_TOKEN, l_str, &rng);
+    print_dta(string);
+    if (string != NULL)
+        free_token_array(string);
+
+    // Cleanup
+    breakdown_count_table(&ct);
+    breakdown_grammar_hash_table(&grammar_hash);
+    unload_grammar_file(&gf);
+
+    return 0;
+}
@@ -0,0 +1,62 @@
+#ifndef BUDGET_H
+#define BUDGET_H
+
+#include "../grammar.h"
+
+// The cost of a symbol which cannot derive any string.
+#define COST_INF SIZE_MAX
+
+/**
+ * The cost of the cheapest string each part of a grammar can derive, used
+ * by the fuzzer to keep its output within a budget. The cost of a string is
+ * the sum of the costs of its terminals: 1 each to count tokens, or the
+ * length of each terminal's string to count bytes.
+ */
+typedef struct MinCostTable
+{
+    const Grammar* grammar;     // The grammar the costs were computed for.
+    size_t* key_min;            // Cost of the cheapest string each non-terminal derives.
+    size_t* rule_min;           // Cost of the cheapest string each rule derives, by global rule index.
+    uint32_t* cheapest_rule;    // The global index of a rule of each non-terminal with cost key_min.
+    size_t* terminal_cost;      // Cost of each terminal, indexed by key.
+    size_t num_terminals;       // Number of entries in `terminal_cost`.
+} MinCostTable;
+
+/**
+ * @brief Computes the cheapest cost of every non-terminal and rule.
+ *
+ * Following `cheapest_rule` from any non-terminal always completes a
+ * derivation: the chosen rules never lead back to a non-terminal already
+ * being expanded, even through rules which cost nothing.
+ *
+ * @param table The MinCostTable to populate.
+ * @param grammar The grammar to analyse.
+ * @param terminal_costs The cost of each terminal, indexed by key, e.g.,
+ *      `GrammarFile.terminal_lengths` to budget in bytes. If NULL, every
+ *      terminal costs 1 and budgets are counted in tokens.
+ * @param num_terminals The number of entries in `terminal_costs`.
+ * @return int `0` on success, otherwise `-1`.
+ *
+ * @see breakdown_min_cost_table, fuzzer_set_budget
+ */
+int init_min_cost_table(MinCostTable* table, const Grammar* grammar,
+    const uint32_t* terminal_costs, size_t num_terminals);
+
+/**
+ * @brief Frees the tables allocated by `init_min_cost_table`.
+ */
+void breakdown_min_cost_table(MinCostTable* table);
+
+/**
+ * @brief Returns the cost of the cheapest string `key` can derive, or
+ * COST_INF if it derives none.
+ */
+static inline size_t key_min_cost(const MinCostTable* table, Token key)
+{
+    int nt_index;
+    if ((nt_index = is_non_terminal(key)) != -1)
+        return table->key_min[nt_index];
+    return key < table->num_terminals ? table->terminal_cost[key] : 1;
+}
+
+#endif // BUDGET_H
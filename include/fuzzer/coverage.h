@@ -0,0 +1,108 @@
+#ifndef COVERAGE_H
+#define COVERAGE_H
+
+#include "../grammar.h"
+#include "../grammar_file.h"
+#include "weights.h"
+
+/**
+ * How often each rule of a grammar has been used to expand a non-terminal.
+ * Hits are recorded in one byte per rule, which saturates at 255 rather than
+ * wrapping, so recording a hit is a single byte increment and coverage can be
+ * left on while fuzzing. Counts merged in from other maps are kept in 64
+ * bits, so a campaign's map tells a rule hit 255 times from one hit millions
+ * of times.
+ *
+ * A RuleCoverage must only be updated by one thread at a time. Give every
+ * worker its own and combine them with `merge_rule_coverage`.
+ */
+typedef struct RuleCoverage
+{
+    const Grammar* grammar;     // The grammar the coverage is recorded for.
+    uint8_t* hits;              // The saturating hit count of each rule, by global rule index.
+    uint64_t* totals;           // The hit counts merged in from other maps, by global rule index.
+    double* biased;             // Scratch space for `bias_rule_weights`.
+} RuleCoverage;
+
+/**
+ * @brief Prepares an empty coverage map for `grammar`.
+ *
+ * @return int `0` on success, otherwise `-1`.
+ *
+ * @see breakdown_rule_coverage, fuzzer_set_coverage
+ */
+int init_rule_coverage(RuleCoverage* cov, const Grammar* grammar);
+
+/**
+ * @brief Frees the coverage map.
+ */
+void breakdown_rule_coverage(RuleCoverage* cov);
+
+/**
+ * @brief Resets the hit count of every rule to 0, including merged counts.
+ */
+void clear_rule_coverage(RuleCoverage* cov);
+
+/**
+ * @brief Adds the hit counts of `src`, including those merged into it, to
+ * the merged counts of `dst`. Both must be for the same grammar.
+ */
+void merge_rule_coverage(RuleCoverage* dst, const RuleCoverage* src);
+
+/**
+ * @brief Returns the number of rules which have been hit at least once.
+ */
+size_t rule_coverage_count(const RuleCoverage* cov);
+
+/**
+ * @brief Returns the number of times rule `rule_index` has been hit,
+ * including the counts merged in.
+ */
+static inline uint64_t rule_coverage_hits(const RuleCoverage* cov,
+    size_t rule_index)
+{
+    return cov->totals[rule_index] + cov->hits[rule_index];
+}
+
+/**
+ * @brief Records that rule `rule_index` has been used.
+ */
+static inline void record_rule_hit(RuleCoverage* cov, size_t rule_index)
+{
+    if (cov->hits[rule_index] != UINT8_MAX)
+        cov->hits[rule_index]++;
+}
+
+/**
+ * @brief Shifts rule selection towards rarely used rules, by giving every
+ * rule the weight `base / (1 + hits)`. A rule which has not been hit keeps
+ * its base weight, while one hit 255 times is 256 times less likely to be
+ * picked than its base weight says.
+ *
+ * Recorded hits saturate at 255, so bias from the hits of a recent epoch,
+ * or from a map the epochs are merged into: bias, fuzz, merge the epoch into
+ * the campaign's coverage and clear it, then repeat.
+ *
+ * @param cov The coverage to bias against.
+ * @param base_weights The weight of each rule before biasing, e.g.,
+ *      `GrammarFile.rule_weights`, or NULL to weight every rule 1.
+ * @param rw The weights to update, which must be for the same grammar.
+ * @return int `0` on success, otherwise `-1` if a base weight is invalid.
+ */
+int bias_rule_weights(RuleCoverage* cov, const double* base_weights,
+    RuleWeights* rw);
+
+/**
+ * @brief Writes one line per rule with its hit count, followed by the
+ * number of rules covered, e.g., `<noun> ::= dog	12`.
+ *
+ * @param cov The coverage to export.
+ * @param gf The grammar file the coverage was recorded for, used to name
+ *      the symbols, or NULL to write the keys in hex.
+ * @param out The stream to write to.
+ * @return int `0` on success, otherwise `-1` if writing failed.
+ */
+int write_rule_coverage(const RuleCoverage* cov, const GrammarFile* gf,
+    FILE* out);
+
+#endif // COVERAGE_H
@@ -0,0 +1,183 @@
+#ifndef DERIVATION_H
+#define DERIVATION_H
+
+#include "../grammar.h"
+#include "../grammar_file.h"
+
+// Marks the absence of a node, e.g., the first child of a leaf, and the rule
+// of a root which is a terminal.
+#define DERIVATION_NONE UINT32_MAX
+
+/**
+ * One expansion in a derivation tree: non-terminal `symbol` was expanded
+ * with rule `rule`. Only non-terminals get nodes. The terminals of a rule
+ * are read back from the grammar, so a node's children are the non-terminals
+ * of its rule, in order, linked through `next_sibling`.
+ *
+ * The only node which may be a terminal is a root, when a string was
+ * generated from a terminal key. Its rule is then DERIVATION_NONE.
+ */
+typedef struct DerivationNode
+{
+    uint32_t rule;              // Global index of the rule the symbol was expanded with.
+    uint32_t first_child;       // The node of the rule's first non-terminal, or DERIVATION_NONE.
+    uint32_t next_sibling;      // The node of the next non-terminal in the parent's rule, or DERIVATION_NONE.
+    uint32_t token_start;       // Index in the string of the first token derived from the node.
+    uint32_t token_len;         // Number of tokens derived from the node.
+    Token symbol;               // The non-terminal which was expanded.
+} DerivationNode;
+
+/**
+ * A position in the rule of a node, used to walk a tree without recursion.
+ */
+typedef struct DerivationCursor
+{
+    const Token* next;          // The next token of the node's rule.
+    const Token* end;           // One past the last token of the node's rule.
+    uint32_t node;              // The node being walked.
+    uint32_t child;             // The child of the next non-terminal in the rule.
+} DerivationCursor;
+
+/**
+ * A derivation tree held in one flat arena of nodes, which refer to each
+ * other by index. Nodes are added in the order they were expanded, so a
+ * recorded tree is laid out in pre-order with the root first. The arena and
+ * the walking stack keep their capacity when the tree is cleared, so
+ * recording one tree per string only allocates until they fit the largest.
+ */
+typedef struct DerivationTree
+{
+    const Grammar* grammar;     // The grammar the tree derives from.
+    DerivationNode* nodes;      // The arena holding every node.
+    uint32_t num_nodes;         // Number of nodes in the arena.
+    uint32_t capacity;          // Number of nodes allocated for the arena.
+    uint32_t root;              // The node the string was derived from, or DERIVATION_NONE.
+    uint32_t num_tokens;        // Number of tokens in the string.
+    DerivationCursor* stack;    // Scratch space for walking the tree.
+    size_t stack_capacity;      // Number of cursors allocated for the stack.
+} DerivationTree;
+
+/**
+ * @brief Prepares an empty derivation tree for `grammar`.
+ *
+ * @param tree The DerivationTree to initialise.
+ * @param grammar The grammar the tree derives from. It must outlive the tree.
+ * @param capacity The number of nodes to allocate up front, which may be 0.
+ * @return int `0` on success, otherwise `-1`.
+ *
+ * @see breakdown_derivation_tree, fuzzer_set_derivation
+ */
+int init_derivation_tree(DerivationTree* tree, const Grammar* grammar,
+    size_t capacity);
+
+/**
+ * @brief Frees the arena and stack of a derivation tree.
+ */
+void breakdown_derivation_tree(DerivationTree* tree);
+
+/**
+ * @brief Removes every node from a tree while keeping its capacity.
+ */
+void clear_derivation_tree(DerivationTree* tree);
+
+/**
+ * @brief Makes room in the arena for `num_nodes` more nodes.
+ *
+ * @return int `0` on success, otherwise `-1` if the arena could not grow.
+ */
+int reserve_derivation_tree(DerivationTree* tree, size_t num_nodes);
+
+/**
+ * @brief Appends a node to the arena. Its children and token span are left
+ * empty.
+ *
+ * @param tree The tree to add to.
+ * @param parent The node whose rule `symbol` belongs to, or DERIVATION_NONE
+ *      to make the new node the root.
+ * @param prev_sibling The previous child of `parent`, or DERIVATION_NONE if
+ *      the new node is its first child.
+ * @param symbol The token which was expanded.
+ * @param rule The global index of the rule it was expanded with, or
+ *      DERIVATION_NONE for a terminal.
+ * @param token_start The index in the string of the node's first token.
+ * @return uint32_t The index of the new node, otherwise DERIVATION_NONE if
+ *      the arena could not grow.
+ */
+uint32_t add_derivation_node(DerivationTree* tree, uint32_t parent,
+    uint32_t prev_sibling, Token symbol, uint32_t rule, uint32_t token_start);
+
+/**
+ * @brief Sets the token span of every node recorded from `first_node` on,
+ * given the number of terminals in each node's own rule in `token_len`.
+ * Each node's span then covers its whole subtree.
+ */
+void finish_derivation_tree(DerivationTree* tree, uint32_t first_node);
+
+/**
+ * @brief Replaces `dst` with an exact copy of `src`, including any nodes no
+ * longer reachable from the root. Both must be for the same grammar.
+ *
+ * @return int `0` on success, otherwise `-1` if the arena could not grow.
+ */
+int copy_derivation_tree(DerivationTree* dst, const DerivationTree* src);
+
+/**
+ * @brief Replaces `dst` with a copy of the nodes of `src` reachable from its
+ * root, laid out in pre-order. Every subtree of a compact tree then occupies
+ * a contiguous run of the arena, directly after its root. Spans are copied
+ * as they are. Both trees must be for the same grammar.
+ *
+ * @return int `0` on success, otherwise `-1` if the arena or stack could not
+ *      grow.
+ */
+int compact_derivation_tree(DerivationTree* dst, const DerivationTree* src);
+
+/**
+ * @brief Returns one past the index of the last node in the subtree of
+ * `node`, which must be laid out in pre-order, e.g., in a compact or freshly
+ * recorded tree. The descendants of `node` are the nodes from `node + 1` up
+ * to this index.
+ */
+uint32_t derivation_subtree_end(const DerivationTree* tree, uint32_t node);
+
+/**
+ * @brief Appends a copy of the nodes `begin` to `end - 1` of `src` to the
+ * arena of `dst`, with their links moved along with them. The nodes must
+ * only link to each other, apart from links out of the run's last nodes,
+ * e.g., the descendants of a node in pre-order. `src` may be `dst`.
+ *
+ * @return uint32_t The index of the copy of `begin`, otherwise
+ *      DERIVATION_NONE if the arena could not grow.
+ */
+uint32_t append_derivation_nodes(DerivationTree* dst, const DerivationTree* src,
+    uint32_t begin, uint32_t end);
+
+/**
+ * @brief Appends the string derived by the tree to `out`, and sets the token
+ * span of every node reachable from the root to where it ended up. This
+ * reads only the tree and the grammar, so it replays a recorded string
+ * exactly and serialises a tree whose nodes have been relinked.
+ *
+ * @param tree The tree to serialise.
+ * @param out An initialised TokenArray in which to store the string.
+ * @return int `0` on success, otherwise `-1` if the stack or `out` could not
+ *      grow, or the sink of `out` asked to stop.
+ */
+int derivation_tree_string(DerivationTree* tree, TokenArray* out);
+
+/**
+ * @brief Writes the tree one node per line in pre-order, indented by depth,
+ * with the rule of each node and the span of the string it derives, e.g.,
+ * `  <noun> ::= dog	[3, 4)`.
+ *
+ * @param tree The tree to write.
+ * @param gf The grammar file the tree was recorded for, used to name the
+ *      symbols, or NULL to write the keys in hex.
+ * @param out The stream to write to.
+ * @return int `0` on success, otherwise `-1` if the stack could not grow or
+ *      writing failed.
+ */
+int write_derivation_tree(DerivationTree* tree, const GrammarFile* gf,
+    FILE* out);
+
+#endif // DERIVATION_H
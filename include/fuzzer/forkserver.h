@@ -0,0 +1,107 @@
+#ifndef FORKSERVER_H
+#define FORKSERVER_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <sys/types.h>
+
+// The file descriptors the target's fork server reads commands from and
+// writes replies to.
+#define FORKSERVER_CONTROL_FD 198
+#define FORKSERVER_STATUS_FD 199
+
+// The environment variable which names the shared memory holding the input.
+#define FORKSERVER_SHM_ENV "GRAMMAR_FUZZER_SHM_ID"
+
+// Sent by the fork server once it is ready for the first input.
+#define FORKSERVER_HELLO 0x46535256
+
+/**
+ * The input shared between the fuzzer and the target.
+ */
+typedef struct ForkServerInput
+{
+    uint32_t length;            // Number of bytes of the input.
+    uint8_t bytes[];            // The bytes of the input.
+} ForkServerInput;
+
+/**
+ * Runs a standalone target on many inputs without an exec per input. The
+ * target calls `forkserver_start` at the top of `main`, which forks a child
+ * for every input once everything before it has been done. Inputs are
+ * passed through shared memory and the child's wait status comes back over
+ * a pipe:
+ *
+ *  1. The fuzzer starts the target with the pipes on FORKSERVER_CONTROL_FD
+ *     and FORKSERVER_STATUS_FD and the shared memory named by
+ *     FORKSERVER_SHM_ENV. The target replies with FORKSERVER_HELLO.
+ *  2. For each input, the fuzzer writes the input to shared memory and any
+ *     4 bytes to the control pipe. The target forks, replies with the
+ *     child's pid, and then with its wait status once it has ended.
+ *
+ * The fuzzer times each child itself and kills it if it runs for too long,
+ * so the target needs no timer of its own.
+ */
+typedef struct ForkServer
+{
+    pid_t pid;                  // The target's fork server.
+    int control_fd;             // Written to start a child.
+    int status_fd;              // Read for each child's pid and wait status.
+    int shm_id;                 // The shared memory holding the input.
+    ForkServerInput* input;     // The shared memory, attached.
+    size_t max_length;          // Number of bytes the input may hold.
+    size_t execs;               // Number of children run.
+} ForkServer;
+
+/**
+ * @brief Starts a target and waits for its fork server to say hello. The
+ * target inherits stdin, stdout and stderr. SIGPIPE is ignored from then on,
+ * so a target which dies is reported as an error rather than ending the
+ * fuzzer.
+ *
+ * @param fs The ForkServer to initialise.
+ * @param argv The path of the target and its arguments, ending with NULL.
+ * @param max_length The most bytes of an input the target should be given.
+ * @param timeout_ms The longest the target may take to say hello, or 0 for
+ *      no limit.
+ * @return int `0` on success, otherwise `-1`, e.g., if the target does not
+ *      call `forkserver_start`.
+ *
+ * @see run_fork_server, breakdown_fork_server
+ */
+int init_fork_server(ForkServer* fs, char* const argv[], size_t max_length,
+    unsigned timeout_ms);
+
+/**
+ * @brief Kills the target and frees the shared memory.
+ */
+void breakdown_fork_server(ForkServer* fs);
+
+/**
+ * @brief Runs a child of the target on one input and waits for it to end.
+ *
+ * @param fs An initialised ForkServer.
+ * @param data The input. Only the first `max_length` bytes are passed on.
+ * @param size The number of bytes of the input.
+ * @param timeout_ms The longest the child may run for, or 0 for no limit.
+ * @param status Set to the child's wait status, e.g., for `WIFSIGNALED`.
+ * @return int `0` if the child ended by itself, `1` if it was killed for
+ *      running past the timeout, otherwise `-1` if the fork server has died.
+ */
+int run_fork_server(ForkServer* fs, const uint8_t* data, size_t size,
+    unsigned timeout_ms, int* status);
+
+/**
+ * @brief Called by the target, at the top of `main` or after any set up
+ * which every input shares. When the target was started by a ForkServer, this
+ * only returns in the children, once per input; the target's own process
+ * stays in the fork server loop until the fuzzer goes away.
+ *
+ * @param data Set to the input.
+ * @param size Set to the number of bytes of the input.
+ * @return int `0` in a child with an input, otherwise `-1` if the target was
+ *      not started by a ForkServer and should read its input as usual.
+ */
+int forkserver_start(const uint8_t** data, size_t* size);
+
+#endif // FORKSERVER_H
@@ -1,27 +1,245 @@
-#ifndef FUZZER_H 
-#define FUZZER_H 
+#ifndef FUZZER_H
+#define FUZZER_H
 
 #include "../grammar.h"
+#include "../rng.h"
+#include "budget.h"
+#include "weights.h"
+#include "coverage.h"
+#include "derivation.h"
 #include <time.h>
 
 /**
- * @brief Perform inverse unification on a given key in a grammar and stores
- * the fuzzed strings into a `TokenArray`.
- * 
- * @param key
- * @param grammar
- * @param fuzzed
+ * A reference to the tokens of a rule which are still to be expanded.
  */
-void unify_key_inv(Token key, Grammar* grammar, TokenArray* fuzzed);
+typedef struct FuzzerFrame
+{
+    const Token* next;          // The next token of the rule to expand.
+    const Token* end;           // One past the last token of the rule.
+    uint32_t node;              // The derivation node of the rule, when recording.
+    uint32_t last_child;        // The node of the rule's last expanded non-terminal, when recording.
+} FuzzerFrame;
+
+/**
+ * The state of the generation engine. The work stack is kept between calls,
+ * so a Fuzzer can generate any number of strings without allocating once
+ * the stack has grown to fit the grammar.
+ */
+typedef struct Fuzzer
+{
+    const Grammar* grammar;     // The grammar to generate strings from.
+    Rng rng;                    // Picks the rule each non-terminal is expanded with.
+    const RuleWeights* weights; // The weight of each rule, or NULL to pick rules uniformly.
+    RuleCoverage* coverage;     // Counts the rules used, or NULL.
+    DerivationTree* derivation; // Records the derivation of the last string, or NULL.
+    FuzzerFrame* stack;         // Rules whose expansion is in progress, innermost last.
+    size_t depth;               // Number of frames on the stack.
+    size_t capacity;            // Number of frames allocated for the stack.
+    const MinCostTable* costs;  // Costs used to keep within `budget`, or NULL for no budget.
+    size_t budget;              // The maximum cost of a generated string.
+    size_t slack;               // How much more than the cheapest completion the string may still cost.
+} Fuzzer;
+
+/**
+ * @brief Prepares a Fuzzer to generate strings from `grammar`.
+ *
+ * @param fuzzer The Fuzzer to initialise.
+ * @param grammar A Grammar struct representing a BNF grammar. It must
+ *      outlive the Fuzzer.
+ * @param seed The seed for the Fuzzer's generator. The same seed generates
+ *      the same strings. To run several Fuzzers on one seed without
+ *      repeating strings, give each its own stream with `rng_split`.
+ * @return int `0` on success, otherwise `-1`.
+ *
+ * @see breakdown_fuzzer
+ */
+int init_fuzzer(Fuzzer* fuzzer, const Grammar* grammar, uint64_t seed);
+
+/**
+ * @brief Frees the work stack allocated by the Fuzzer.
+ */
+void breakdown_fuzzer(Fuzzer* fuzzer);
+
+/**
+ * @brief Makes the Fuzzer pick each rule with probability proportional to
+ * its weight, rather than uniformly. Weights changed with `set_rule_weight`
+ * apply to the next rule picked.
+ *
+ * @param fuzzer An initialised Fuzzer.
+ * @param weights The weights of the Fuzzer's grammar, or NULL to pick rules
+ *      uniformly again. It must outlive its use by the Fuzzer.
+ */
+void fuzzer_set_weights(Fuzzer* fuzzer, const RuleWeights* weights);
+
+/**
+ * @brief Makes the Fuzzer record every rule it uses in `coverage`.
+ *
+ * @param fuzzer An initialised Fuzzer.
+ * @param coverage The coverage map for the Fuzzer's grammar, or NULL to
+ *      stop recording. It must outlive its use by the Fuzzer.
+ */
+void fuzzer_set_coverage(Fuzzer* fuzzer, RuleCoverage* coverage);
+
+/**
+ * @brief Makes the Fuzzer record how it derived each string from its key in
+ * `tree`, replacing the previous derivation. Recording costs one node per
+ * non-terminal expanded, and the tree's arena is reused from string to
+ * string. After `fuzz_batch`, the tree holds the batch's last string.
+ *
+ * @param fuzzer An initialised Fuzzer.
+ * @param tree A derivation tree for the Fuzzer's grammar, or NULL to stop
+ *      recording. It must outlive its use by the Fuzzer.
+ *
+ * @see derivation_tree_string
+ */
+void fuzzer_set_derivation(Fuzzer* fuzzer, DerivationTree* tree);
+
+/**
+ * @brief Limits the cost of every string the Fuzzer generates from now on,
+ * e.g., to a number of tokens or bytes (see `init_min_cost_table`).
+ *
+ * Rules are picked as usual while there is room for them. A rule whose
+ * cheapest completion would take the string over `budget` is replaced by
+ * the non-terminal's cheapest rule, and once the budget is used up only the
+ * cheapest rules are followed. Every string therefore finishes within the
+ * budget in a bounded number of steps, provided the cheapest string of the
+ * start token fits. If it does not, the cheapest string is generated.
+ *
+ * @param fuzzer An initialised Fuzzer.
+ * @param costs The costs of the Fuzzer's grammar, or NULL to remove the
+ *      budget. It must outlive its use by the Fuzzer.
+ * @param budget The maximum cost of a string.
+ */
+void fuzzer_set_budget(Fuzzer* fuzzer, const MinCostTable* costs,
+    size_t budget);
+
+/**
+ * @brief Perform inverse unification on a given key in a grammar and appends
+ * the fuzzed string to a `TokenArray`. If the array has a sink, every token
+ * has been passed to it by the time this returns.
+ *
+ * Non-terminals are expanded depth-first and left to right using the
+ * Fuzzer's explicit stack rather than recursion, so the depth of a
+ * derivation is only limited by memory. A rule whose last token is being
+ * expanded is popped first, so right-recursive rules do not grow the stack.
+ *
+ * @param key The token to start generating from.
+ * @param fuzzer An initialised Fuzzer.
+ * @param fuzzed An initialised TokenArray in which to store the fuzzed string.
+ * @return int `0` on success, otherwise `-1` if the stack, `fuzzed` or the
+ *      derivation tree could not grow, the sink of `fuzzed` asked to stop,
+ *      or the Fuzzer has a budget and `key` cannot derive any string. The
+ *      derivation tree is then empty.
+ */
+int unify_key_inv(Token key, Fuzzer* fuzzer, TokenArray* fuzzed);
+
+/**
+ * @brief Generates a string from `key` as `unify_key_inv` does, and adds its
+ * derivation to `tree` as a new subtree, whichever tree the Fuzzer records
+ * into. The rest of the tree is left as it was, so the new subtree can be
+ * linked in place of an existing one. The spans of its nodes count from
+ * the subtree's first token.
+ *
+ * @param key The token to start generating from.
+ * @param fuzzer An initialised Fuzzer.
+ * @param tree The tree to add the subtree to.
+ * @param fuzzed An initialised TokenArray in which to store the fuzzed string.
+ * @return uint32_t The root of the new subtree, whose descendants follow it
+ *      in pre-order, otherwise DERIVATION_NONE on any failure of
+ *      `unify_key_inv`. No nodes are added then.
+ */
+uint32_t derive_subtree(Token key, Fuzzer* fuzzer, DerivationTree* tree,
+    TokenArray* fuzzed);
 
 /**
  * @brief For each token of the given rule, generate some terminal strings by
- * running `unify_key_inv` on it.
- * 
- * @param rule A specific rule contained in a NonTerminal from which to generate strings.
- * @param grammar A Grammar struct representing a BNF grammar.
- * @param fuzzed A previously allocated array in which to store all fuzzed strings.
+ * running `unify_key_inv` on it. As the string has no single key, its
+ * derivation is not recorded, and the derivation tree is left empty.
+ *
+ * @param rule A view of a rule in the grammar from which to generate strings.
+ * @param fuzzer An initialised Fuzzer.
+ * @param fuzzed An initialised TokenArray in which to store the fuzzed string.
+ * @return int `0` on success, otherwise `-1` if the stack or `fuzzed` could
+ *      not grow, the sink of `fuzzed` asked to stop, or the Fuzzer has a
+ *      budget and `rule` cannot derive any string.
+ */
+int unify_rule_inv(Rule rule, Fuzzer* fuzzer, TokenArray* fuzzed);
+
+/**
+ * A batch of generated strings stored back to back in one token arena.
+ * String `i` spans `tokens.tokens[offsets[i]]` to
+ * `tokens.tokens[offsets[i + 1] - 1]`, in the same way as rules in a
+ * Grammar's token pool.
+ */
+typedef struct FuzzBatch
+{
+    TokenArray tokens;          // The arena holding every string of the batch.
+    size_t* offsets;            // num_strings + 1 offsets into the arena.
+    size_t num_strings;         // Number of strings in the batch.
+    size_t capacity;            // Number of strings `offsets` has room for.
+} FuzzBatch;
+
+/**
+ * @brief Prepares an empty FuzzBatch. Both sizes are only hints: the arena
+ * and the offsets grow as needed and keep their capacity between batches.
+ *
+ * @param batch The FuzzBatch to initialise.
+ * @param num_strings The number of strings to allocate offsets for.
+ * @param num_tokens The number of tokens to allocate the arena with.
+ * @return int `0` on success, otherwise `-1`.
+ *
+ * @see fuzz_batch, breakdown_fuzz_batch
+ */
+int init_fuzz_batch(FuzzBatch* batch, size_t num_strings, size_t num_tokens);
+
+/**
+ * @brief Frees the arena and offsets of a FuzzBatch.
+ */
+void breakdown_fuzz_batch(FuzzBatch* batch);
+
+/**
+ * @brief Replaces the contents of `batch` with `num_strings` strings
+ * generated from `key`, as if by calling `unify_key_inv` once per string.
+ *
+ * @param key The token to start generating from.
+ * @param num_strings The number of strings to generate.
+ * @param fuzzer An initialised Fuzzer.
+ * @param batch An initialised FuzzBatch.
+ * @return int `0` on success, otherwise `-1` if the batch or the stack could
+ *      not grow. The batch then holds the strings completed so far.
+ */
+int fuzz_batch(Token key, size_t num_strings, Fuzzer* fuzzer, FuzzBatch* batch);
+
+/**
+ * @brief Returns a pointer to the first token of string `i` in a batch.
+ */
+static inline const Token* fuzz_batch_string(const FuzzBatch* batch, size_t i)
+{
+    return batch->tokens.tokens + batch->offsets[i];
+}
+
+/**
+ * @brief Returns the number of tokens in string `i` of a batch.
+ */
+static inline size_t fuzz_batch_length(const FuzzBatch* batch, size_t i)
+{
+    return batch->offsets[i + 1] - batch->offsets[i];
+}
+
+/**
+ * @brief A specialised equivalent of `unify_key_inv` for a single grammar.
+ * This function is not part of the library: it is defined by the C source
+ * file written by `converter.py --codegen` (`./data/grammar_gen.c`), which
+ * must be compiled into your program. Each non-terminal becomes its own
+ * function with the grammar's rules compiled in, so no Grammar struct is
+ * read at runtime.
+ *
+ * @param key The token to start generating from.
+ * @param rng The generator picking each non-terminal's rule.
+ * @param fuzzed An initialised TokenArray in which to store the fuzzed string.
+ * @return int `0` on success, otherwise `-1` if `fuzzed` could not grow, or
+ *      its sink asked to stop.
  */
-void unify_rule_inv(Rule rule, Grammar* grammar, TokenArray* fuzzed);
+int unify_key_inv_gen(Token key, Rng* rng, TokenArray* fuzzed);
 
-#endif
\ No newline at end of file
+#endif
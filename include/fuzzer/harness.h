@@ -0,0 +1,118 @@
+#ifndef HARNESS_H
+#define HARNESS_H
+
+#include "../grammar.h"
+#include "../grammar_file.h"
+#include "fuzzer.h"
+#include "forkserver.h"
+
+// The exit status of a run ended by an input which hung the target.
+#define HARNESS_TIMEOUT_EXIT 70
+
+/**
+ * The function under test, in the same form as a libFuzzer target. It is
+ * called once per input in the harness' own process.
+ *
+ * @return int `0` for an input handled correctly. Anything else reports a
+ *      failure, e.g., a failed check, and the input is saved as a crash.
+ */
+typedef int (*FuzzTarget)(const uint8_t* data, size_t size);
+
+/**
+ * A growable buffer of bytes, reused from input to input.
+ */
+typedef struct ByteArray
+{
+    uint8_t* bytes;             // The bytes.
+    size_t length;              // Number of bytes in the buffer.
+    size_t capacity;            // Number of bytes allocated.
+} ByteArray;
+
+/**
+ * Runs a target on generated inputs in a tight loop, in one process. Each
+ * string is turned into the bytes of its terminals and passed straight to
+ * the target, so nothing is spawned or copied per input beyond that.
+ *
+ * An input is saved to `crash_dir` when:
+ *
+ *  - the target returns non-zero, and the run carries on;
+ *  - the target dies of a signal such as SIGSEGV or SIGABRT, and the process
+ *    then dies of the same signal;
+ *  - the target takes longer than `timeout_ms`. If it returns, the input is
+ *    saved as a timeout and the run carries on. If it is still running when
+ *    the watchdog next checks, the process exits with HARNESS_TIMEOUT_EXIT.
+ *
+ * Signal handlers are process-wide, so only one Harness may run at a time.
+ *
+ * When `server` is set, each input is run by a child of a standalone target
+ * instead of by `target`. A child which exits with a non-zero status or dies
+ * of a signal counts as a crash, and one which runs past `timeout_ms` is
+ * killed and counts as a timeout. The run carries on either way.
+ */
+typedef struct Harness
+{
+    const GrammarFile* gf;      // Names the bytes of each terminal.
+    Fuzzer* fuzzer;             // Generates the inputs.
+    FuzzTarget target;          // The function under test.
+    ForkServer* server;         // Runs the inputs instead of `target`, when set.
+    const char* crash_dir;      // Where failing inputs are saved, or NULL to not save them.
+    unsigned timeout_ms;        // The longest an input may run for, or 0 for no limit.
+    double report_interval;     // Seconds between progress lines on stderr, or 0 for none.
+    TokenArray tokens;          // The string being run.
+    ByteArray input;            // The bytes of the string being run.
+    size_t execs;               // Number of inputs run.
+    size_t crashes;             // Number of inputs for which the target returned non-zero.
+    size_t timeouts;            // Number of inputs which ran for longer than `timeout_ms`.
+    double seconds;             // Time spent in `run_harness`.
+} Harness;
+
+/**
+ * @brief Appends the bytes of the terminals of a string to `out`.
+ *
+ * @param gf The grammar file the string was generated from.
+ * @param tokens The string.
+ * @param num_tokens The number of tokens in the string.
+ * @param out The buffer to append to.
+ * @return int `0` on success, otherwise `-1` if the buffer could not grow
+ *      or the string holds a token which is not a terminal of `gf`.
+ */
+int detokenise(const GrammarFile* gf, const Token* tokens, size_t num_tokens,
+    ByteArray* out);
+
+/**
+ * @brief Prepares a Harness. Its options may be changed before each run.
+ *
+ * @param h The Harness to initialise.
+ * @param gf The grammar file of the Fuzzer's grammar.
+ * @param fuzzer An initialised Fuzzer, which may have weights, coverage or a
+ *      budget set.
+ * @param target The function under test, or NULL if `server` will be set.
+ * @param crash_dir An existing directory to save failing inputs in, or NULL.
+ * @return int `0` on success, otherwise `-1`.
+ *
+ * @see run_harness, breakdown_harness
+ */
+int init_harness(Harness* h, const GrammarFile* gf, Fuzzer* fuzzer,
+    FuzzTarget target, const char* crash_dir);
+
+/**
+ * @brief Frees the buffers of a Harness.
+ */
+void breakdown_harness(Harness* h);
+
+/**
+ * @brief Generates inputs from `key` and runs the target on each, adding to
+ * the Harness' counts. Progress is written to stderr every
+ * `report_interval` seconds, e.g.,
+ * `#1048576	2951102 execs/s	0 crashes	0 timeouts`.
+ *
+ * @param h An initialised Harness.
+ * @param key The token to generate inputs from.
+ * @param num_execs The number of inputs to run, or 0 to run forever.
+ * @return int `0` on success, otherwise `-1` if an input could not be
+ *      generated, the watchdog could not be started or the fork server has
+ *      died.
+ */
+int run_harness(Harness* h, Token key, size_t num_execs);
+
+#endif // HARNESS_H
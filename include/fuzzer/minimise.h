@@ -0,0 +1,89 @@
+#ifndef MINIMISE_H
+#define MINIMISE_H
+
+#include "../grammar.h"
+#include "fuzzer.h"
+#include "budget.h"
+#include "derivation.h"
+
+/**
+ * A callback which decides whether a candidate string still shows the
+ * behaviour being minimised for, e.g., by running the target on it and
+ * checking that it crashes in the same way.
+ *
+ * @return int Non-zero if the string should be kept, otherwise `0`.
+ */
+typedef int (*MinimisePredicate)(const Token* tokens, size_t num_tokens, void* ctx);
+
+/**
+ * Shrinks a string by its derivation tree, so every candidate is a string of
+ * the grammar. Each candidate changes the tree rather than the bytes:
+ *
+ *  - Subtrees are replaced with the smallest derivation of their
+ *    non-terminal. The subtrees of each level of the tree are tried together
+ *    and then in smaller and smaller groups (hierarchical delta debugging),
+ *    starting from the root.
+ *  - A subtree is replaced with a smaller subtree of the same non-terminal
+ *    nested inside it, e.g., `((x))` with `(x)`.
+ *  - A node is expanded with another rule of its non-terminal. Its children
+ *    are kept where the new rule has the same non-terminals, in the same
+ *    order, and the rest get their smallest derivations.
+ *
+ * Only candidates shorter than the current string are tested, so every
+ * accepted candidate shrinks the string and minimisation always ends.
+ */
+typedef struct Minimiser
+{
+    const Grammar* grammar;     // The grammar of the strings to minimise.
+    MinCostTable costs;         // The length of each non-terminal's smallest derivation.
+    Fuzzer smallest;            // Derives the smallest subtree of a non-terminal.
+    MinimisePredicate predicate;// Decides which candidates to keep.
+    void* ctx;                  // Passed to every call of `predicate`.
+    DerivationTree tree;        // The smallest derivation found so far, compact.
+    TokenArray tokens;          // The string derived by `tree`.
+    DerivationTree candidate;   // The derivation being tested.
+    TokenArray scratch;         // The string being tested.
+    uint32_t* depth;            // Scratch space: the depth of each node of `tree`.
+    uint32_t* level;            // Scratch space: the nodes of one level of `tree`.
+    uint32_t* config;           // Scratch space: the nodes kept by a delta debugging step.
+    uint32_t* subset;           // Scratch space: the nodes kept by a candidate.
+    uint8_t* kept;              // Scratch space: whether each node of a level is kept.
+    size_t scratch_capacity;    // Number of entries allocated for each scratch array.
+    size_t num_tests;           // Number of times `predicate` has been called.
+} Minimiser;
+
+/**
+ * @brief Prepares a Minimiser for strings of `grammar`.
+ *
+ * @param m The Minimiser to initialise.
+ * @param grammar The grammar of the strings to minimise. It must outlive the
+ *      Minimiser.
+ * @param predicate Decides which candidates to keep.
+ * @param ctx Passed to every call of `predicate`.
+ * @return int `0` on success, otherwise `-1`.
+ *
+ * @see minimise, breakdown_minimiser
+ */
+int init_minimiser(Minimiser* m, const Grammar* grammar,
+    MinimisePredicate predicate, void* ctx);
+
+/**
+ * @brief Frees the buffers of a Minimiser.
+ */
+void breakdown_minimiser(Minimiser* m);
+
+/**
+ * @brief Shrinks the string derived by `tree` for as long as the predicate
+ * keeps holding, e.g., for a tree recorded by a Fuzzer or a Mutator. The
+ * result is left in `m->tokens`, with its derivation in `m->tree`. No single
+ * subtree of the result can be replaced as above without the predicate
+ * failing.
+ *
+ * @param m An initialised Minimiser.
+ * @param tree The derivation of the string to minimise.
+ * @return int `0` on success, otherwise `-1` if a buffer could not grow or
+ *      the predicate does not hold for the string of `tree`.
+ */
+int minimise(Minimiser* m, const DerivationTree* tree);
+
+#endif // MINIMISE_H
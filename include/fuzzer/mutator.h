@@ -0,0 +1,143 @@
+#ifndef MUTATOR_H
+#define MUTATOR_H
+
+#include "../grammar.h"
+#include "fuzzer.h"
+#include "derivation.h"
+
+/**
+ * A string kept for mutation, with the derivation it came from. The tree is
+ * compact, and the spans of its nodes index into `tokens`.
+ */
+typedef struct CorpusEntry
+{
+    DerivationTree tree;        // The derivation of the string, in pre-order.
+    TokenArray tokens;          // The string derived by the tree.
+} CorpusEntry;
+
+/**
+ * A node in one of the entries of a Corpus.
+ */
+typedef struct NodeRef
+{
+    uint32_t entry;             // Index of the entry holding the node.
+    uint32_t node;              // Index of the node in the entry's tree.
+} NodeRef;
+
+/**
+ * Every node in a Corpus which expands one non-terminal.
+ */
+typedef struct NodeRefList
+{
+    NodeRef* refs;              // The nodes, in the order they were added.
+    size_t count;               // Number of nodes in the list.
+    size_t capacity;            // Number of nodes allocated for the list.
+} NodeRefList;
+
+/**
+ * The strings a Mutator starts from, e.g., the inputs which reached new
+ * behaviour in a target. The nodes of every entry are indexed by the
+ * non-terminal they expand, so that a subtree can be swapped for one of the
+ * same type from any other entry.
+ */
+typedef struct Corpus
+{
+    const Grammar* grammar;     // The grammar of every entry.
+    CorpusEntry* entries;       // The entries, in the order they were added.
+    size_t num_entries;         // Number of entries in the corpus.
+    size_t capacity;            // Number of entries allocated.
+    NodeRefList* by_symbol;     // The nodes of each non-terminal, by non-terminal index.
+} Corpus;
+
+/**
+ * The ways in which a Mutator can change a string.
+ */
+typedef enum MutationType
+{
+    MUTATE_ANY,                 // Any of the below, picked at random.
+    MUTATE_REGENERATE,          // Replace a subtree with a fresh expansion of its non-terminal.
+    MUTATE_SPLICE,              // Replace a subtree with one of the same non-terminal from the corpus.
+    MUTATE_RECURSE,             // Repeat a recursive rule, e.g., turn `(x)` into `((x))`.
+    NUM_MUTATION_TYPES
+} MutationType;
+
+/**
+ * Produces mutants of the entries of a Corpus. Each mutant is a copy of an
+ * entry's tree with one subtree replaced. The subtree's nodes are added to
+ * the end of the copy, and the replaced node is relinked to them, so nothing
+ * else in the tree is touched. The string is put together from the entry's
+ * string around the replaced span, without walking the tree. The mutant's
+ * tree and string are reused from one mutation to the next.
+ */
+typedef struct Mutator
+{
+    Fuzzer* fuzzer;             // Generates fresh subtrees and draws every random choice.
+    const Corpus* corpus;       // The entries to mutate and take subtrees from.
+    uint32_t max_recursions;    // The most times MUTATE_RECURSE repeats a rule.
+    DerivationTree tree;        // The derivation of the last mutant.
+    TokenArray tokens;          // The last mutant.
+} Mutator;
+
+/**
+ * @brief Prepares an empty Corpus.
+ *
+ * @return int `0` on success, otherwise `-1`.
+ *
+ * @see add_corpus_entry, breakdown_corpus
+ */
+int init_corpus(Corpus* corpus, const Grammar* grammar);
+
+/**
+ * @brief Frees every entry of a Corpus and its index.
+ */
+void breakdown_corpus(Corpus* corpus);
+
+/**
+ * @brief Adds a copy of the string derived by `tree` to the corpus, e.g., a
+ * tree recorded by a Fuzzer or a Mutator's last mutant. Only the nodes
+ * reachable from the root are kept.
+ *
+ * @return int `0` on success, otherwise `-1` if the corpus could not grow,
+ *      or `tree` is empty.
+ */
+int add_corpus_entry(Corpus* corpus, const DerivationTree* tree);
+
+/**
+ * @brief Prepares a Mutator.
+ *
+ * @param m The Mutator to initialise.
+ * @param fuzzer An initialised Fuzzer for the corpus' grammar. Fresh subtrees
+ *      follow its weights and budget, with the budget applying to each
+ *      subtree on its own.
+ * @param corpus The entries to mutate. Entries may be added while the
+ *      Mutator is in use.
+ * @param max_recursions The most times MUTATE_RECURSE repeats a rule, which
+ *      must be at least 1.
+ * @return int `0` on success, otherwise `-1`.
+ *
+ * @see mutate, breakdown_mutator
+ */
+int init_mutator(Mutator* m, Fuzzer* fuzzer, const Corpus* corpus,
+    uint32_t max_recursions);
+
+/**
+ * @brief Frees the mutant buffers of a Mutator.
+ */
+void breakdown_mutator(Mutator* m);
+
+/**
+ * @brief Replaces the Mutator's mutant with a mutation of a corpus entry.
+ * The new string is in `m->tokens` and its derivation in `m->tree`. The
+ * tree's spans are only brought up to date when it is added to a corpus.
+ *
+ * @param m An initialised Mutator.
+ * @param entry The index of the corpus entry to mutate.
+ * @param type The mutation to apply. MUTATE_ANY falls back to
+ *      MUTATE_REGENERATE when the mutation it picked does not apply.
+ * @return int `0` on success, `1` if the mutation does not apply to the
+ *      entry, e.g., MUTATE_RECURSE on a string without recursion, otherwise
+ *      `-1` if a buffer could not grow or no fresh subtree could be derived.
+ */
+int mutate(Mutator* m, size_t entry, MutationType type);
+
+#endif // MUTATOR_H
@@ -0,0 +1,108 @@
+#ifndef PARALLEL_H
+#define PARALLEL_H
+
+#include "fuzzer.h"
+#include "ring.h"
+#include <pthread.h>
+
+// The number of batches allocated per worker thread. Workers wait when
+// every batch is waiting to be consumed.
+#define BATCHES_PER_WORKER 4
+
+struct ParallelFuzzer;
+
+/**
+ * The state owned by a single worker thread. Nothing in it is shared, so
+ * workers never contend while generating.
+ */
+typedef struct FuzzWorker
+{
+    struct ParallelFuzzer* pf;  // The ParallelFuzzer the worker belongs to.
+    Fuzzer fuzzer;              // The worker's own stack and PRNG stream.
+    pthread_t thread;           // The thread running the worker.
+} FuzzWorker;
+
+/**
+ * Generates strings on several threads at once. Each worker fills whole
+ * FuzzBatches with its own Fuzzer and PRNG stream, and pushes them onto the
+ * lock-free `ready` ring, from which any number of consumer threads pull
+ * them. Consumed batches go back on the `empty` ring to be refilled, so a
+ * running ParallelFuzzer does not allocate. Workers wait while there is no
+ * empty batch, which holds generation back to the pace of the consumers.
+ *
+ * Workers only touch shared state once per batch, so throughput scales with
+ * the number of cores as long as batches are reasonably large. The
+ * occupancy of `ready` (see `ring_stats`) shows which side is the
+ * bottleneck: mostly full means slow consumers, mostly empty slow workers.
+ */
+typedef struct ParallelFuzzer
+{
+    Token key;                  // The token every string is generated from.
+    size_t batch_size;          // Number of strings in each batch.
+    size_t num_workers;         // Number of worker threads.
+    FuzzWorker* workers;        // The worker threads.
+    FuzzBatch* pool;            // Storage for every batch.
+    size_t num_batches;         // Number of batches in the pool.
+    Ring ready;                 // Batches waiting to be consumed.
+    Ring empty;                 // Batches waiting to be filled.
+    atomic_int error;           // Set if a worker failed to generate a batch.
+} ParallelFuzzer;
+
+/**
+ * @brief Starts worker threads generating strings from `key`.
+ *
+ * Worker `i` is given the `i`-th stream split off a generator seeded with
+ * `seed` (see `rng_split`), so each worker's strings are reproducible. The
+ * order in which the batches of different workers are consumed is not.
+ *
+ * @param pf The ParallelFuzzer to start.
+ * @param grammar The grammar to generate strings from. It must outlive `pf`.
+ * @param key The token to start generating from.
+ * @param num_threads The number of worker threads, or `0` for one per
+ *      online core.
+ * @param batch_size The number of strings in each batch.
+ * @param seed The seed all worker streams are derived from.
+ * @return int `0` on success, otherwise `-1`.
+ *
+ * @see parallel_fuzzer_next, stop_parallel_fuzzer
+ */
+int start_parallel_fuzzer(ParallelFuzzer* pf, const Grammar* grammar,
+    Token key, size_t num_threads, size_t batch_size, uint64_t seed);
+
+/**
+ * @brief Takes the next generated batch off the `ready` ring, waiting until
+ * one is ready. Safe to call from several consumer threads.
+ *
+ * @return FuzzBatch* The batch, which must be handed back with
+ *      `parallel_fuzzer_release` once consumed, or NULL if the fuzzer has
+ *      been stopped or a worker failed.
+ */
+FuzzBatch* parallel_fuzzer_next(ParallelFuzzer* pf);
+
+/**
+ * @brief Takes up to `max_batches` generated batches off the `ready` ring at
+ * once, waiting until at least one is ready. Safe to call from several
+ * consumer threads.
+ *
+ * @param pf A started ParallelFuzzer.
+ * @param batches Set to the batches, each of which must be handed back with
+ *      `parallel_fuzzer_release` once consumed.
+ * @param max_batches The most batches to take.
+ * @return size_t The number of batches taken, or `0` if the fuzzer has been
+ *      stopped or a worker failed.
+ */
+size_t parallel_fuzzer_next_batches(ParallelFuzzer* pf, FuzzBatch** batches,
+    size_t max_batches);
+
+/**
+ * @brief Returns a consumed batch to the workers to be refilled.
+ */
+void parallel_fuzzer_release(ParallelFuzzer* pf, FuzzBatch* batch);
+
+/**
+ * @brief Stops and joins the worker threads and frees every batch. Batches
+ * returned by `parallel_fuzzer_next` are no longer valid afterwards.
+ */
+void stop_parallel_fuzzer(ParallelFuzzer* pf);
+
+#endif // PARALLEL_H
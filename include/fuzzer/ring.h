@@ -0,0 +1,137 @@
+#ifndef RING_H
+#define RING_H
+
+#include <stdatomic.h>
+#include <stddef.h>
+
+// The size of a cache line, which the ends of a Ring are kept apart by.
+#define RING_CACHE_LINE 64
+
+/**
+ * A slot of a Ring. Its sequence number says whose turn it is: a producer
+ * may fill the slot for position `p` once it equals `p`, and a consumer may
+ * empty it once it equals `p + 1`.
+ */
+typedef struct RingSlot
+{
+    atomic_size_t sequence;     // The position the slot is ready for next.
+    void* item;                 // The item held, once filled.
+} RingSlot;
+
+/**
+ * Counts of how a Ring has been used. The mean occupancy shows which side
+ * is the bottleneck: a ring which is mostly full has slow consumers, and one
+ * which is mostly empty has slow producers.
+ */
+typedef struct RingStats
+{
+    size_t pushes;              // Number of items pushed.
+    size_t pops;                // Number of items popped.
+    size_t full_waits;          // Number of pushes which waited for space.
+    size_t empty_waits;         // Number of pops which waited for an item.
+    double mean_occupancy;      // Mean number of items held, sampled at each push.
+} RingStats;
+
+/**
+ * A bounded, lock-free queue of pointers for many producers and many
+ * consumers (Vyukov's bounded MPMC queue). Each push or pop claims a position
+ * with a single compare-and-swap and hands the slot over with its sequence
+ * number, so threads never block each other while holding the ring.
+ *
+ * A producer which finds the ring full waits for space (backpressure), and a
+ * consumer which finds it empty waits for an item. Waiting spins, then
+ * yields, then sleeps, until the ring is closed.
+ */
+typedef struct Ring
+{
+    RingSlot* slots;            // The ring buffer.
+    size_t mask;                // The number of slots minus one.
+    atomic_int closed;          // Set to make every waiting thread give up.
+    char pad0[RING_CACHE_LINE];
+    atomic_size_t head;         // The next position to pop.
+    char pad1[RING_CACHE_LINE];
+    atomic_size_t tail;         // The next position to push.
+    char pad2[RING_CACHE_LINE];
+    atomic_size_t pushes;       // See RingStats.
+    atomic_size_t pops;
+    atomic_size_t full_waits;
+    atomic_size_t empty_waits;
+    atomic_size_t occupancy_sum;// The sum of the occupancy sampled at each push.
+} Ring;
+
+/**
+ * @brief Prepares an empty Ring.
+ *
+ * @param ring The Ring to initialise.
+ * @param capacity The most items the ring must hold. It is rounded up to a
+ *      power of two.
+ * @return int `0` on success, otherwise `-1`.
+ *
+ * @see breakdown_ring
+ */
+int init_ring(Ring* ring, size_t capacity);
+
+/**
+ * @brief Frees the slots of a Ring, once no thread is using it.
+ */
+void breakdown_ring(Ring* ring);
+
+/**
+ * @brief Makes every thread waiting on the ring give up, now and from then
+ * on. Items already in the ring may still be popped without waiting.
+ */
+void close_ring(Ring* ring);
+
+/**
+ * @brief Pushes an item if there is space, without waiting.
+ *
+ * @return int `0` on success, otherwise `-1` if the ring is full.
+ */
+int ring_try_push(Ring* ring, void* item);
+
+/**
+ * @brief Pushes an item, waiting for space while the ring is full.
+ *
+ * @return int `0` on success, otherwise `-1` if the ring was closed while
+ *      waiting.
+ */
+int ring_push(Ring* ring, void* item);
+
+/**
+ * @brief Pops up to `max_items` items in order, claiming all of them at once.
+ * Does not wait.
+ *
+ * @param ring The Ring to pop from.
+ * @param items Set to the items popped.
+ * @param max_items The most items to pop.
+ * @return size_t The number of items popped, `0` if the ring is empty.
+ */
+size_t ring_try_pop_batch(Ring* ring, void** items, size_t max_items);
+
+/**
+ * @brief Pops up to `max_items` items, waiting while the ring is empty.
+ *
+ * @return size_t The number of items popped, at least one unless the ring
+ *      was closed while waiting.
+ */
+size_t ring_pop_batch(Ring* ring, void** items, size_t max_items);
+
+/**
+ * @brief Pops one item, waiting while the ring is empty.
+ *
+ * @return void* The item, or NULL if the ring was closed while waiting.
+ */
+void* ring_pop(Ring* ring);
+
+/**
+ * @brief Returns the number of items in the ring at the moment. The count may
+ * be out of date by the time it is used.
+ */
+size_t ring_occupancy(Ring* ring);
+
+/**
+ * @brief Fills `stats` with the counts so far.
+ */
+void ring_stats(Ring* ring, RingStats* stats);
+
+#endif // RING_H
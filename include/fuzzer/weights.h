@@ -0,0 +1,97 @@
+#ifndef WEIGHTS_H
+#define WEIGHTS_H
+
+#include "../grammar.h"
+#include "../rng.h"
+
+/**
+ * The weight of every rule in a grammar, compiled into one alias table
+ * (Walker's method, built with Vose's algorithm) per non-terminal. Picking
+ * a rule then costs a single random draw and a table lookup, however many
+ * rules a non-terminal has.
+ *
+ * The table of non-terminal `i` occupies the slots of its own rules, i.e.,
+ * global rule indices `rule_offsets[i]` to `rule_offsets[i + 1] - 1`. A
+ * slot picks its own rule with probability `threshold / 2^32`, and its
+ * `alias` otherwise.
+ */
+typedef struct RuleWeights
+{
+    const Grammar* grammar;     // The grammar the weights belong to.
+    double* weights;            // The weight of each rule, by global rule index.
+    uint32_t* threshold;        // The probability of each slot keeping its own rule, scaled to 2^32.
+    uint32_t* alias;            // The global index of the rule each slot picks otherwise.
+    double* scaled;             // Scratch space used to rebuild a table.
+    uint32_t* work;             // Scratch space used to rebuild a table.
+} RuleWeights;
+
+/**
+ * @brief Builds the alias tables of every non-terminal in `grammar`.
+ *
+ * @param rw The RuleWeights to initialise.
+ * @param grammar The grammar to weight. It must outlive `rw`.
+ * @param weights The weight of each rule by global rule index, e.g.,
+ *      `GrammarFile.rule_weights`, or NULL to weight every rule 1.
+ * @return int `0` on success, otherwise `-1` if out of memory or a weight is
+ *      negative or not finite.
+ *
+ * @see breakdown_rule_weights, set_rule_weight, fuzzer_set_weights
+ */
+int init_rule_weights(RuleWeights* rw, const Grammar* grammar,
+    const double* weights);
+
+/**
+ * @brief Frees the tables allocated by `init_rule_weights`.
+ */
+void breakdown_rule_weights(RuleWeights* rw);
+
+/**
+ * @brief Changes the weight of one rule, e.g., during a campaign. Only the
+ * alias table of the rule's non-terminal is rebuilt, and nothing is
+ * allocated.
+ *
+ * The tables must not be in use by another thread while they are updated.
+ *
+ * @param rw The RuleWeights to update.
+ * @param rule_index The global index of the rule.
+ * @param weight The new weight. A non-terminal whose rules all weigh 0
+ *      picks its rules uniformly.
+ * @return int `0` on success, otherwise `-1` if the rule does not exist, or
+ *      the weight is negative or not finite.
+ */
+int set_rule_weight(RuleWeights* rw, size_t rule_index, double weight);
+
+/**
+ * @brief Replaces the weight of every rule at once and rebuilds every alias
+ * table, without allocating.
+ *
+ * The tables must not be in use by another thread while they are updated.
+ *
+ * @param rw The RuleWeights to update.
+ * @param weights The new weight of each rule, by global rule index.
+ * @return int `0` on success, otherwise `-1` if a weight is negative or not
+ *      finite, in which case no weight is changed.
+ */
+int update_rule_weights(RuleWeights* rw, const double* weights);
+
+/**
+ * @brief Picks a rule of non-terminal `nt_index` with probability
+ * proportional to its weight.
+ *
+ * The high 32 bits of one draw pick a slot and the low 32 bits decide
+ * between the slot and its alias. The slot is chosen with a multiply rather
+ * than a rejection loop, which biases it by less than `num_rules / 2^32`.
+ *
+ * @return size_t The global index of the rule.
+ */
+static inline size_t choose_weighted_rule(const RuleWeights* rw,
+    size_t nt_index, Rng* rng)
+{
+    uint64_t x = rng_next(rng);
+    uint64_t num_rules = grammar_num_rules(rw->grammar, nt_index);
+    size_t slot = grammar_first_rule(rw->grammar, nt_index)
+        + (size_t) (((x >> 32) * num_rules) >> 32);
+    return (uint32_t) x < rw->threshold[slot] ? slot : rw->alias[slot];
+}
+
+#endif // WEIGHTS_H
@@ -5,60 +5,224 @@
 #include <stdlib.h>
 #include <stdio.h>
 
-// Change as per the size of your grammar.
-#define MAX_TOKENS_IN_RULE 1024 
-#define MAX_RULES_FOR_NONTERMINAL 1024
-#define MAX_NONTERMINALS_IN_GRAMMAR 128
-#define MAX_STRINGS_IN_LANGUAGE 100
+// The number of tokens a TokenArray allocates when it first needs space.
+#define TOKEN_ARRAY_INITIAL_CAPACITY 64
+
+// The width of a Token in bits: 8, 16 or 32. The default 8-bit tokens allow
+// for up to 127 non-terminals and 128 terminals; compile with
+// -DTOKEN_BITS=16 or -DTOKEN_BITS=32 for larger grammars.
+#ifndef TOKEN_BITS
+#define TOKEN_BITS 8
+#endif
 
 /**
- * A Grammar is an array of NonTerminals. 
- * A NonTerminal has a name (an 8-bit id), and an array of rules.
- * A Rule consists of several Tokens, e.g., "<article> <noun>".
- * The Tokens are written in 8-bit form.
+ * A Grammar is stored in compressed-sparse-row (CSR) form:
+ *
+ *  - `tokens` is one contiguous pool holding the tokens of every rule, with
+ *    the rules laid out back to back.
+ *  - `token_offsets[r]` is the index in `tokens` at which rule `r` starts, so
+ *    rule `r` spans `tokens[token_offsets[r]]` to
+ *    `tokens[token_offsets[r + 1] - 1]`.
+ *  - `rule_offsets[i]` is the index of the first rule of non-terminal `i`, so
+ *    non-terminal `i` owns rules `rule_offsets[i]` to
+ *    `rule_offsets[i + 1] - 1`.
+ *
+ * The name of non-terminal `i` is implied by its position (see
+ * `is_non_terminal`). The Tokens are written in TOKEN_BITS-bit form.
  */
 
+#if TOKEN_BITS == 8
 typedef uint8_t Token;                  // Represents an 8-bit token.
+#elif TOKEN_BITS == 16
+typedef uint16_t Token;                 // Represents a 16-bit token.
+#elif TOKEN_BITS == 32
+typedef uint32_t Token;                 // Represents a 32-bit token.
+#else
+#error "TOKEN_BITS must be 8, 16 or 32"
+#endif
+
+// The MSB of a Token is set for non-terminals, and the remaining bits hold
+// the index of the non-terminal in the Grammar.
+#define NON_TERMINAL_FLAG ((Token) 1 << (TOKEN_BITS - 1))
+#define NON_TERMINAL_MASK ((Token) (NON_TERMINAL_FLAG - 1))
+
+// The token of the non-terminal at index `i`, e.g., NON_TERMINAL(0) is 0x80
+// for 8-bit tokens.
+#define NON_TERMINAL(i) ((Token) (NON_TERMINAL_FLAG | (i)))
+
+// The all-ones token is reserved as a sentinel, so the largest non-terminal
+// index is NON_TERMINAL_MASK - 1.
+#define MAX_NON_TERMINALS ((size_t) NON_TERMINAL_MASK)
 
+/**
+ * A Rule is a view over a run of consecutive Tokens in a Grammar's token
+ * pool, e.g., "<article> <noun>". It does not own its tokens and is cheap to
+ * pass by value.
+ */
 typedef struct Rule
 {
     size_t num_tokens;                  // Number of tokens in the rule.
-    Token tokens[MAX_TOKENS_IN_RULE];   // Array of tokens in the rule.
+    const Token* tokens;                // Pointer to the first token of the rule.
 } Rule;
 
-typedef struct NonTerminal
-{
-    Token name;                             // 8-bit id representing the name of the non-terminal.
-    size_t num_rules;                       // Number of rules associated with the non-terminal.
-    Rule rules[MAX_RULES_FOR_NONTERMINAL];  // Array of rules associated with the non-terminal.
-} NonTerminal;
-
 typedef struct Grammar
 {
-    size_t num_non_terminals;               // Number of non-terminals in the grammar.
-    NonTerminal non_terminals[MAX_NONTERMINALS_IN_GRAMMAR];    // Array of non-terminals in the grammar.
+    size_t num_non_terminals;           // Number of non-terminals in the grammar.
+    size_t num_rules;                   // Total number of rules in the grammar.
+    size_t num_tokens;                  // Total number of tokens across all rules.
+    const uint32_t* rule_offsets;       // num_non_terminals + 1 offsets into the rules.
+    const uint32_t* token_offsets;      // num_rules + 1 offsets into `tokens`.
+    const Token* tokens;                // Token pool holding every rule back to back.
 } Grammar;
 
-typedef struct TokenArray 
+/**
+ * A callback which receives the tokens of a TokenArray when its buffer is
+ * full, and once more when generation of a string has finished. The tokens
+ * are only valid until the callback returns.
+ *
+ * @return int `0` to continue, anything else to stop generating.
+ */
+typedef int (*TokenSink)(const Token* tokens, size_t num_tokens, void* ctx);
+
+/**
+ * A caller-owned buffer the fuzzer writes generated tokens into. Without a
+ * sink, the buffer doubles in size whenever it is full and holds the whole
+ * string. With a sink, the buffer never grows: it is passed to the sink and
+ * emptied instead, so strings of any length stream through a fixed amount
+ * of memory.
+ *
+ * The capacity is kept when the array is cleared, so reusing one TokenArray
+ * for many strings only allocates until it has grown to fit the longest.
+ */
+typedef struct TokenArray
 {
-    size_t index;                           // Current index in the token array.
-    Token tokens[MAX_STRINGS_IN_LANGUAGE];  // Array of tokens representing strings in the language.
+    size_t index;               // Number of tokens currently in the buffer.
+    size_t capacity;            // Number of tokens allocated for the buffer.
+    Token* tokens;              // Array of tokens representing strings in the language.
+    TokenSink sink;             // Receives the buffered tokens when full, or NULL to grow instead.
+    void* sink_ctx;             // Passed to every call of `sink`.
 } TokenArray;
 
 extern Grammar GRAMMAR;  // Declaration of the external variable representing the grammar.
 
+/**
+ * @brief Returns the number of rules belonging to non-terminal `nt_index`.
+ */
+static inline size_t grammar_num_rules(const Grammar* grammar, size_t nt_index)
+{
+    return grammar->rule_offsets[nt_index + 1] - grammar->rule_offsets[nt_index];
+}
+
+/**
+ * @brief Returns the global index (into `token_offsets`) of the first rule
+ * belonging to non-terminal `nt_index`.
+ */
+static inline size_t grammar_first_rule(const Grammar* grammar, size_t nt_index)
+{
+    return grammar->rule_offsets[nt_index];
+}
+
+/**
+ * @brief Returns a view of the rule with global index `rule_index`.
+ */
+static inline Rule grammar_rule(const Grammar* grammar, size_t rule_index)
+{
+    uint32_t start = grammar->token_offsets[rule_index];
+    Rule rule = {
+        grammar->token_offsets[rule_index + 1] - start,
+        grammar->tokens + start
+    };
+    return rule;
+}
+
 /**
  * @brief Tests if the given key is a non-terminal by checking if the MSB is
  * set. If so, the function returns the index of the non-terminal in the
- * Grammar `non_terminals` array. The index will be the LSB, given that the 
- * Grammar struct was created properly.
- * 
+ * Grammar, i.e., the `i` for which `rule_offsets[i]` holds its rules. The
+ * index is held in the remaining bits of the key, given that the Grammar
+ * struct was created properly.
+ *
  * @param key The key to be verified as non-terminal.
- * @param grammar The grammar struct representing a BNF grammar.
  * @return int The index of the non-terminal inside the grammar, otherwise -1.
  */
 int is_non_terminal(Token key);
 
+/**
+ * @brief Prepares an empty TokenArray which grows as tokens are added.
+ *
+ * @param arr The TokenArray to initialise.
+ * @param capacity The number of tokens to allocate up front, which may be 0.
+ * @return int `0` on success, otherwise `-1`.
+ *
+ * @see init_token_array_sink, breakdown_token_array
+ */
+int init_token_array(TokenArray* arr, size_t capacity);
+
+/**
+ * @brief Prepares an empty TokenArray which passes its tokens to `sink` in
+ * chunks of at most `capacity` tokens rather than growing.
+ *
+ * @param arr The TokenArray to initialise.
+ * @param capacity The size of each chunk, which must be at least 1.
+ * @param sink The callback receiving the tokens.
+ * @param ctx Passed to every call of `sink`.
+ * @return int `0` on success, otherwise `-1`.
+ *
+ * @see init_token_array, breakdown_token_array
+ */
+int init_token_array_sink(TokenArray* arr, size_t capacity, TokenSink sink,
+    void* ctx);
+
+/**
+ * @brief Frees the buffer of a TokenArray.
+ */
+void breakdown_token_array(TokenArray* arr);
+
+/**
+ * @brief Empties a TokenArray while keeping its capacity, ready for the
+ * next string.
+ */
+void clear_token_array(TokenArray* arr);
+
+/**
+ * @brief Passes any buffered tokens to the sink of a TokenArray and empties
+ * it. Does nothing for a TokenArray without a sink.
+ *
+ * @return int `0` on success, otherwise `-1` if the sink asked to stop.
+ */
+int flush_token_array(TokenArray* arr);
+
+/**
+ * @brief Makes room for at least one more token in a full TokenArray, by
+ * flushing it to its sink or else growing it. Used by `token_array_push`.
+ *
+ * @return int `0` on success, otherwise `-1`.
+ */
+int token_array_make_room(TokenArray* arr);
+
+/**
+ * @brief Appends `key` to a TokenArray.
+ *
+ * @return int `0` on success, otherwise `-1` if the array could not grow or
+ *      the sink asked to stop.
+ */
+static inline int token_array_push(TokenArray* arr, Token key)
+{
+    if (arr->index == arr->capacity && token_array_make_room(arr) != 0)
+        return -1;
+    arr->tokens[arr->index++] = key;
+    return 0;
+}
+
+/**
+ * @brief Appends `num_tokens` tokens to a TokenArray, as if by pushing them
+ * one at a time.
+ *
+ * @return int `0` on success, otherwise `-1` if the array could not grow or
+ *      the sink asked to stop.
+ */
+int token_array_append(TokenArray* arr, const Token* tokens, size_t num_tokens);
+
 void print_token_array(TokenArray* fuzzed);
 
-#endif
\ No newline at end of file
+#endif
@@ -0,0 +1,109 @@
+#ifndef GRAMMAR_FILE_H
+#define GRAMMAR_FILE_H
+
+#include "grammar.h"
+
+#define GRAMMAR_FILE_MAGIC "GFZG"
+#define GRAMMAR_FILE_VERSION 2
+
+/**
+ * The on-disk layout of a binary grammar file, as written by
+ * `converter.py --binary`. All integers are little-endian, and every section
+ * is referenced by its byte offset from the start of the file, so the file
+ * can be mapped at any address and used in place.
+ *
+ *  - `rule_offsets`: uint32_t[num_non_terminals + 1], as in `Grammar`.
+ *  - `token_offsets`: uint32_t[num_rules + 1], as in `Grammar`.
+ *  - `tokens`: Token[num_tokens], as in `Grammar`.
+ *  - `terminal_lengths`: uint32_t[num_terminals], the length of the string
+ *    each terminal produces.
+ *  - `terminal_strs`: uint32_t[num_terminals + 1] offsets into `strings`.
+ *  - `non_terminal_strs`: uint32_t[num_non_terminals + 1] offsets into
+ *    `strings`.
+ *  - `strings`: the names of every symbol, each terminated by a NUL byte.
+ *  - `rule_weights`: double[num_rules], the weight of each rule (see
+ *    `init_rule_weights`). 1 unless given in the JSON grammar.
+ *
+ * Sections are aligned to 8 bytes.
+ */
+typedef struct GrammarFileHeader
+{
+    char magic[4];                  // Always GRAMMAR_FILE_MAGIC.
+    uint32_t version;               // Format version, GRAMMAR_FILE_VERSION.
+    uint32_t token_bits;            // Width of a Token in bits.
+    uint32_t num_non_terminals;     // Number of non-terminals in the grammar.
+    uint32_t num_terminals;         // Number of terminals in the grammar.
+    uint32_t num_rules;             // Total number of rules in the grammar.
+    uint32_t num_tokens;            // Total number of tokens across all rules.
+    uint32_t strings_size;          // Size of the `strings` section in bytes.
+    uint64_t rule_offsets;          // Byte offset of the rule offsets section.
+    uint64_t token_offsets;         // Byte offset of the token offsets section.
+    uint64_t tokens;                // Byte offset of the token pool.
+    uint64_t terminal_lengths;      // Byte offset of the terminal lengths.
+    uint64_t terminal_strs;         // Byte offset of the terminal string offsets.
+    uint64_t non_terminal_strs;     // Byte offset of the non-terminal string offsets.
+    uint64_t strings;               // Byte offset of the string pool.
+    uint64_t rule_weights;          // Byte offset of the rule weights.
+} GrammarFileHeader;
+
+/**
+ * A binary grammar file mapped into memory. `grammar` points straight into
+ * the mapping, so no part of the file is copied.
+ */
+typedef struct GrammarFile
+{
+    Grammar grammar;                    // The grammar, backed by the mapping.
+    size_t num_terminals;               // Number of terminals in the grammar.
+    const uint32_t* terminal_lengths;   // Length of the string each terminal produces.
+    const uint32_t* terminal_strs;      // Offsets of terminal strings in `strings`.
+    const uint32_t* non_terminal_strs;  // Offsets of non-terminal names in `strings`.
+    const char* strings;                // NUL-terminated symbol names.
+    const double* rule_weights;         // Weight of each rule, by global rule index.
+    void* map;                          // Start of the mapping.
+    size_t map_size;                    // Size of the mapping in bytes.
+} GrammarFile;
+
+/**
+ * @brief Maps a binary grammar file written by `converter.py --binary` into
+ * memory and validates it, so that `gf->grammar` can be used directly by the
+ * fuzzer and the sampler.
+ *
+ * @param gf The GrammarFile to populate.
+ * @param path The path to the binary grammar file.
+ * @return int `0` on success, otherwise `-1` with the reason printed to
+ *      stderr. On failure `gf` does not need to be unloaded.
+ *
+ * @see unload_grammar_file
+ */
+int load_grammar_file(GrammarFile* gf, const char* path);
+
+/**
+ * @brief Unmaps a grammar loaded with `load_grammar_file`. Any Grammar or
+ * Rule views taken from it become invalid.
+ *
+ * @param gf The GrammarFile to unload.
+ */
+void unload_grammar_file(GrammarFile* gf);
+
+/**
+ * @brief Returns the name of the given token as written in the original
+ * grammar, e.g., "<start>" or "horse".
+ *
+ * @param gf The GrammarFile the token belongs to.
+ * @param key The token to look up.
+ * @return const char* The NUL-terminated name, or NULL if `key` is not part
+ *      of the grammar.
+ */
+const char* grammar_file_token_str(const GrammarFile* gf, Token key);
+
+/**
+ * @brief Writes the name of the given token to `out`, or the token in hex if
+ * it has no name.
+ *
+ * @param gf The GrammarFile the token belongs to, or NULL to write in hex.
+ * @param key The token to write.
+ * @param out The stream to write to.
+ */
+void write_grammar_file_token(const GrammarFile* gf, Token key, FILE* out);
+
+#endif // GRAMMAR_FILE_H
@@ -0,0 +1,66 @@
+#ifndef GRAMMAR_NORMALISE_H
+#define GRAMMAR_NORMALISE_H
+
+#include "grammar.h"
+
+/**
+ * A grammar produced by `normalise_grammar`, along with the storage backing
+ * it and a mapping from its non-terminals back to the original grammar.
+ */
+typedef struct NormalisedGrammar
+{
+    Grammar grammar;            // The normalised grammar. Non-terminal 0 is the start symbol.
+    Token* original_keys;       // original_keys[i] is the key of non-terminal i in the original grammar.
+    uint32_t* rule_offsets;     // Storage for grammar.rule_offsets.
+    uint32_t* token_offsets;    // Storage for grammar.token_offsets.
+    Token* tokens;              // Storage for grammar.tokens.
+} NormalisedGrammar;
+
+/**
+ * @brief Simplifies a grammar before it is used for fuzzing or sampling. The
+ * following passes are applied in order:
+ *
+ *  1. Rules using unproductive non-terminals (ones which cannot derive a
+ *     string of terminals) are removed, along with those non-terminals.
+ *  2. Unit rules (`<a> ::= <b>`) are collapsed: `<a>` takes on the rules of
+ *     every non-terminal it reaches through unit rules.
+ *  3. Identical rules of the same non-terminal are merged.
+ *  4. Non-terminals unreachable from `start` are removed.
+ *
+ * The surviving non-terminals are renumbered densely with `start` as
+ * non-terminal 0, so `NON_TERMINAL(0)` is the new start token. Terminal keys
+ * are left unchanged, so tables keyed by terminals (e.g. the grammar hash
+ * table) remain valid.
+ *
+ * The normalised grammar derives exactly the same language from `start`.
+ * However, as rules are merged and collapsed, the fuzzer picks between
+ * alternatives with different probabilities and the sampler counts each
+ * string once per distinct derivation of the normalised grammar.
+ *
+ * @param ng The NormalisedGrammar to populate.
+ * @param grammar The grammar to normalise. It is not modified.
+ * @param start The start token of `grammar`.
+ * @return int `0` on success, otherwise `-1` with the reason printed to
+ *      stderr. On failure `ng` does not need to be broken down.
+ *
+ * @see breakdown_normalised_grammar, original_token
+ */
+int normalise_grammar(NormalisedGrammar* ng, const Grammar* grammar,
+    Token start);
+
+/**
+ * @brief Frees the storage of a grammar created by `normalise_grammar`.
+ */
+void breakdown_normalised_grammar(NormalisedGrammar* ng);
+
+/**
+ * @brief Maps a token of the normalised grammar back to the corresponding
+ * token of the original grammar, e.g. for printing reports.
+ *
+ * @param ng The NormalisedGrammar the token belongs to.
+ * @param key A token of the normalised grammar.
+ * @return Token The token in the original grammar.
+ */
+Token original_token(const NormalisedGrammar* ng, Token key);
+
+#endif // GRAMMAR_NORMALISE_H
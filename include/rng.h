@@ -0,0 +1,115 @@
+#ifndef RNG_H
+#define RNG_H
+
+#include <stdint.h>
+
+/**
+ * The state of a xoshiro256** pseudo-random number generator. It replaces
+ * the global `rand()` in the fuzzer and the sampler: every generator is
+ * independent, so threads never share state, and a generator seeded with
+ * the same value always produces the same stream.
+ *
+ * A generator can be split into non-overlapping streams with `rng_split`,
+ * e.g., one per worker thread, while staying reproducible from one seed.
+ */
+typedef struct Rng
+{
+    uint64_t s[4];              // The 256 bits of generator state. Never all zero.
+} Rng;
+
+/**
+ * @brief Seeds a generator. The 64-bit seed is expanded with SplitMix64, so
+ * similar seeds still give unrelated streams.
+ *
+ * @param rng The generator to seed.
+ * @param seed Any value, including 0.
+ */
+void rng_seed(Rng* rng, uint64_t seed);
+
+/**
+ * @brief Advances `rng` by 2^128 draws, the equivalent of that many calls to
+ * `rng_next`.
+ */
+void rng_jump(Rng* rng);
+
+/**
+ * @brief Splits off an independent stream from `parent`. `child` continues
+ * the stream `parent` was on, while `parent` jumps 2^128 draws ahead, so
+ * the two streams never overlap. Repeatedly splitting one parent gives any
+ * number of non-overlapping streams, in an order fixed by the seed.
+ *
+ * @param parent The generator to split. It is advanced.
+ * @param child The generator to initialise with the new stream.
+ */
+void rng_split(Rng* parent, Rng* child);
+
+static inline uint64_t rng_rotl(uint64_t x, int k)
+{
+    return (x << k) | (x >> (64 - k));
+}
+
+/**
+ * @brief Returns the next 64 uniformly distributed random bits.
+ */
+static inline uint64_t rng_next(Rng* rng)
+{
+    uint64_t* s = rng->s;
+    uint64_t result = rng_rotl(s[1] * 5, 7) * 9;
+    uint64_t t = s[1] << 17;
+
+    s[2] ^= s[0];
+    s[3] ^= s[1];
+    s[1] ^= s[2];
+    s[0] ^= s[3];
+    s[2] ^= t;
+    s[3] = rng_rotl(s[3], 45);
+
+    return result;
+}
+
+/**
+ * @brief Returns a uniformly distributed integer in [0, `bound`), without
+ * the bias of `rand() % bound`. Uses Lemire's multiply-and-reject method,
+ * which needs no division except in the rare case of a rejection.
+ *
+ * @param rng The generator to draw from.
+ * @param bound The exclusive upper limit, which must be at least 1.
+ * @return uint32_t The random integer.
+ */
+static inline uint32_t rng_bounded(Rng* rng, uint32_t bound)
+{
+    uint64_t m = (rng_next(rng) >> 32) * bound;
+    uint32_t low = (uint32_t) m;
+    if (low < bound)
+    {
+        uint32_t threshold = -bound % bound;
+        while (low < threshold)
+        {
+            m = (rng_next(rng) >> 32) * bound;
+            low = (uint32_t) m;
+        }
+    }
+    return (uint32_t) (m >> 32);
+}
+
+/**
+ * @brief Returns a uniformly distributed integer in [0, `bound`), for bounds
+ * too large for `rng_bounded`. Draws are rejected below `2^64 % bound`, so
+ * every remainder is equally likely.
+ *
+ * @param rng The generator to draw from.
+ * @param bound The exclusive upper limit, which must be at least 1.
+ * @return uint64_t The random integer.
+ */
+static inline uint64_t rng_bounded64(Rng* rng, uint64_t bound)
+{
+    uint64_t threshold = -bound % bound;
+    uint64_t x;
+    do
+    {
+        x = rng_next(rng);
+    } while (x < threshold);
+    return x % bound;
+}
+
+#endif // RNG_H
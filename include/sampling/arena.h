@@ -0,0 +1,65 @@
+#ifndef ARENA_H
+#define ARENA_H
+
+#include <stddef.h>
+
+// The number of bytes in each chunk of an Arena, unless a larger one is needed.
+#define ARENA_DEFAULT_CHUNK_SIZE (64 * 1024)
+
+/**
+ * A block of memory handed out by an Arena.
+ */
+typedef struct ArenaChunk
+{
+    struct ArenaChunk* next;    // The chunk to use once this one is full.
+    size_t size;                // Number of bytes in `data`.
+    size_t used;                // Number of bytes handed out.
+    max_align_t data[];         // The memory handed out.
+} ArenaChunk;
+
+/**
+ * A bump allocator for memory which is all freed at once, such as the
+ * KeyNodes and RuleNodes memoized for one grammar and length. Allocating
+ * only moves a pointer along the current chunk, and nothing is freed on its
+ * own. `reset_arena` releases everything in one step but keeps the chunks,
+ * so the next session allocates from the same memory.
+ */
+typedef struct Arena
+{
+    ArenaChunk* first;          // The first chunk, or NULL before any allocation.
+    ArenaChunk* current;        // The chunk being allocated from.
+    size_t chunk_size;          // Number of bytes in each new chunk.
+    size_t allocated;           // Number of bytes handed out since the last reset.
+} Arena;
+
+/**
+ * @brief Prepares an empty Arena. No memory is allocated until it is needed.
+ *
+ * @param arena The Arena to initialise.
+ * @param chunk_size The number of bytes in each chunk, or 0 for
+ *      ARENA_DEFAULT_CHUNK_SIZE.
+ *
+ * @see arena_alloc, reset_arena, breakdown_arena
+ */
+void init_arena(Arena* arena, size_t chunk_size);
+
+/**
+ * @brief Frees every chunk of an Arena.
+ */
+void breakdown_arena(Arena* arena);
+
+/**
+ * @brief Releases everything allocated from an Arena at once, keeping its
+ * chunks for the next allocations. Everything allocated before is invalid
+ * afterwards.
+ */
+void reset_arena(Arena* arena);
+
+/**
+ * @brief Allocates `size` bytes, aligned for any type.
+ *
+ * @return void* The memory, or NULL if a new chunk could not be allocated.
+ */
+void* arena_alloc(Arena* arena, size_t size);
+
+#endif // ARENA_H
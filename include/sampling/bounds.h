@@ -0,0 +1,58 @@
+#ifndef BOUNDS_H
+#define BOUNDS_H
+
+#include "hash.h"
+
+// The maximum length of a symbol which can derive strings of any length.
+#define LENGTH_INF SIZE_MAX
+
+/**
+ * The shortest and longest strings each part of a grammar can derive. The
+ * sampler uses these to skip partitions of a string which cannot possibly
+ * be derived, rather than recursing into them.
+ *
+ * Lengths are measured in the same unit as the `strlen` of terminals in the
+ * grammar hash table. Symbols which derive no strings at all have a minimum
+ * of LENGTH_INF and a maximum of 0.
+ */
+typedef struct LengthBounds
+{
+    const Grammar* grammar;     // The grammar the bounds were computed for.
+    size_t* key_min;            // Shortest string each non-terminal derives.
+    size_t* key_max;            // Longest string each non-terminal derives, or LENGTH_INF.
+    size_t* suffix_min;         // Shortest string the rule suffix starting at each token in the pool derives.
+    size_t* suffix_max;         // Longest string the rule suffix starting at each token in the pool derives, or LENGTH_INF.
+    size_t* terminal_length;    // Length of each terminal, indexed by key.
+    size_t num_terminals;       // Number of entries in `terminal_length`.
+} LengthBounds;
+
+/**
+ * @brief Computes the length bounds of every non-terminal and every rule
+ * suffix in `grammar`.
+ *
+ * @param lb The LengthBounds to populate.
+ * @param grammar The grammar to analyse.
+ * @param table The grammar hash table holding the length of every terminal.
+ * @return int `0` on success, otherwise `-1`.
+ *
+ * @see breakdown_length_bounds
+ */
+int init_length_bounds(LengthBounds* lb, const Grammar* grammar,
+    GrammarHashTable* table);
+
+/**
+ * @brief Frees the tables allocated by `init_length_bounds`.
+ */
+void breakdown_length_bounds(LengthBounds* lb);
+
+/**
+ * @brief Returns the shortest string `key` can derive.
+ */
+size_t key_min_length(const LengthBounds* lb, Token key);
+
+/**
+ * @brief Returns the longest string `key` can derive, or LENGTH_INF.
+ */
+size_t key_max_length(const LengthBounds* lb, Token key);
+
+#endif // BOUNDS_H
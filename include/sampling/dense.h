@@ -0,0 +1,91 @@
+#ifndef DENSE_H
+#define DENSE_H
+
+#include "../grammar.h"
+#include "../rng.h"
+#include "hash.h"
+#include "bounds.h"
+
+/**
+ * The number of derivations of every length up to `max_length`, for every
+ * non-terminal and every rule suffix of a grammar, in flat arrays. This is an
+ * alternative to the KeyNode and RuleNode lists built by `key_get_def`: the
+ * arrays are filled once, bottom-up from length 0, with no recursion and no
+ * allocation per entry, and sampling and unranking then only read them.
+ *
+ * A rule suffix is named by the position of its first token in the grammar's
+ * token pool, so the suffix of a rule starting at its `i`-th token is
+ * `grammar->token_offsets[rule] + i`. Terminals derive only their own string,
+ * and a rule with no tokens derives the empty string.
+ *
+ * Counts are exact 64-bit integers. `init_count_table` fails rather than
+ * let one overflow, so keep `max_length` to the lengths you sample at.
+ */
+typedef struct CountTable
+{
+    const Grammar* grammar;     // The grammar the counts were computed for.
+    size_t max_length;          // The longest length counted.
+    size_t stride;              // Number of lengths per row: `max_length + 1`.
+    uint64_t* key_counts;       // [non-terminal][length] number of derivations.
+    uint64_t* suffix_counts;    // [position in the token pool][length] number of derivations.
+    LengthBounds bounds;        // Limits the lengths each symbol is tried at.
+} CountTable;
+
+/**
+ * @brief Counts the derivations of every length from 0 to `max_length`.
+ *
+ * @param ct The CountTable to fill.
+ * @param grammar The grammar to count. It must outlive the table.
+ * @param table The grammar hash table holding the length of every terminal.
+ * @param max_length The longest length to count.
+ * @return int `0` on success, otherwise `-1` if the tables could not be
+ *      allocated, a count does not fit in 64 bits, or a cycle of rules which
+ *      do not change the length gives some string infinitely many
+ *      derivations.
+ *
+ * @see count_table_count, count_table_string_at, breakdown_count_table
+ */
+int init_count_table(CountTable* ct, const Grammar* grammar,
+    GrammarHashTable* table, size_t max_length);
+
+/**
+ * @brief Frees the arrays of a CountTable.
+ */
+void breakdown_count_table(CountTable* ct);
+
+/**
+ * @brief Returns the number of derivations of length `l_str` from `key`, or 0
+ * if `l_str` is longer than the table's `max_length`.
+ */
+uint64_t count_table_count(const CountTable* ct, Token key, size_t l_str);
+
+/**
+ * @brief Retrieves the string of derivation `at` of length `l_str` from
+ * `key`, working down the tables without recursion.
+ *
+ * @param ct A filled CountTable.
+ * @param key The token to derive from.
+ * @param l_str The length of the string.
+ * @param at The 0-indexed derivation, less than `count_table_count`.
+ * @return DynTokenArray* The string, or NULL if `at` is out of range or the
+ *      string could not be allocated.
+ *
+ * @note It is the responsibility of the caller to free the DTA with
+ *      `free_token_array`.
+ */
+DynTokenArray* count_table_string_at(const CountTable* ct, Token key,
+    size_t l_str, uint64_t at);
+
+/**
+ * @brief Uniformly at random samples a derivation of length `l_str` from
+ * `key`, like `string_sample_UAR`.
+ *
+ * @return DynTokenArray* The string, or NULL if there is no string of length
+ *      `l_str`.
+ *
+ * @see count_table_string_at
+ */
+DynTokenArray* count_table_sample_UAR(const CountTable* ct, Token key,
+    size_t l_str, Rng* rng);
+
+#endif // DENSE_H
@@ -3,14 +3,16 @@
 
 #include <string.h>
 #include "../grammar.h"
+#include "../grammar_file.h"
+#include "arena.h"
 
-// Use the print_%_hash_table functions to adjust these empirically.
-#define GRAMMAR_TABLE_SIZE 20
-#define KEY_TABLE_SIZE 60 
-#define RULE_TABLE_SIZE 30 
+// The number of slots a hash table starts with on its first insert. Tables
+// double whenever they would become more than HASH_TABLE_MAX_LOAD full.
+#define HASH_TABLE_MIN_CAPACITY 16
+#define HASH_TABLE_MAX_LOAD 0.75
 
 #define LENGTH_NA -1
-#define EMPTY_TOKEN 0x88
+#define EMPTY_TOKEN ((Token) ~(Token) 0)
 
 // We hash these to retrieve an index.
 typedef struct 
@@ -31,7 +33,6 @@ struct KeyNode
     size_t l_str;           // Length of the string we want to produce.
     int count;              // The number of strings of length l_str that token can produce.
     RuleNode* rules;        // Pointer to a linked list of RuleNode structs representing the rules associated with the key.
-    struct KeyNode* next;   // Pointer to the next KeyNode in the linked list.
 };
 
 // Represents a node in the linked list of rules.
@@ -44,21 +45,21 @@ struct RuleNode
     struct RuleNode* next;  // Pointer to the next RuleNode in the linked list.
 };
 
-// Represents the values stored in the RuleHashTable, which is a linked list filled with RuleNodes.
+// Represents a slot of the RuleHashTable, which holds a linked list filled with RuleNodes.
+// A rule suffix is identified by the position of its first token in the grammar's token pool.
 struct RuleHashTableVal
 {
-    RuleNode* list;                 // Pointer to the head of a linked list of RuleNode structs.
+    RuleNode* list;                 // Pointer to the head of a linked list of RuleNode structs, or NULL if the slot is empty.
+    size_t suffix;                  // The position of the rule suffix in the token pool.
     size_t l_str;                   // The length of the string associated with the rule.
-    struct RuleHashTableVal* next;  // Pointer to the next RuleHashTableVal in the linked list.
 };
 
-// Represents the values stored in the GrammarHashTable for external chaining.
+// Represents the values stored in the GrammarHashTable.
 typedef struct GrammarHashTableVal 
 {
     Token key;                          // Token associated with the key.
     char* str;                          // Pointer to a string associated with the key.
     size_t strlen;                      // Length of the string associated with the key.
-    struct GrammarHashTableVal* next;   // Pointer to the next GrammarHashTableVal for external chaining.
 } GrammarHashTableVal;
 
 // Represents a "string" as an array of tokens.
@@ -69,15 +70,62 @@ typedef struct DynTokenArray
     struct DynTokenArray* next_dta;     // Pointer to the next DynTokenArray in the linked list.
 } DynTokenArray;
 
-// Our hash tables are arrays of pointers to structs.
-typedef KeyNode* KeyHashTable[KEY_TABLE_SIZE];
-typedef RuleHashTableVal* RuleHashTable[RULE_TABLE_SIZE];
-typedef GrammarHashTableVal* GrammarHashTable[GRAMMAR_TABLE_SIZE];
+// Represents a slot of the KeyHashTable. The key is kept in the slot so that
+// probing does not have to follow the pointer.
+typedef struct KeyHashTableSlot
+{
+    Token key;          // Token associated with the key.
+    size_t l_str;       // The length of the string associated with the key.
+    KeyNode* node;      // The KeyNode for (key, l_str), or NULL if the slot is empty.
+} KeyHashTableSlot;
+
+// Represents a slot of the GrammarHashTable.
+typedef struct GrammarHashTableSlot
+{
+    Token key;                  // Token associated with the key.
+    GrammarHashTableVal* val;   // The value for key, or NULL if the slot is empty.
+} GrammarHashTableSlot;
+
+// Our hash tables use open addressing with linear probing: an entry sits in
+// the first empty slot from the one its hash picks. Each table has a power of
+// two number of slots, allocated on the first insert and doubled as it fills.
+typedef struct KeyHashTable
+{
+    KeyHashTableSlot* slots;    // Array of `capacity` slots, or NULL while empty.
+    size_t capacity;            // Number of slots.
+    size_t count;               // Number of slots in use.
+} KeyHashTable;
+
+typedef struct RuleHashTable
+{
+    RuleHashTableVal* slots;    // Array of `capacity` slots, or NULL while empty.
+    size_t capacity;            // Number of slots.
+    size_t count;               // Number of slots in use.
+} RuleHashTable;
+
+typedef struct GrammarHashTable
+{
+    GrammarHashTableSlot* slots;    // Array of `capacity` slots, or NULL while empty.
+    size_t capacity;                // Number of slots.
+    size_t count;                   // Number of slots in use.
+} GrammarHashTable;
+
+// Mixes the bits of `x` so that nearby inputs land far apart (the finaliser
+// of splitmix64).
+static inline uint64_t mix_hash(uint64_t x)
+{
+    x ^= x >> 30;
+    x *= 0xbf58476d1ce4e5b9ULL;
+    x ^= x >> 27;
+    x *= 0x94d049bb133111ebULL;
+    x ^= x >> 31;
+    return x;
+}
 
 /* FUNCTION DECLARATIONS */
 
 // key_hash_table.c
-int hash_key(Token key, size_t l_str);
+uint64_t hash_key(Token key, size_t l_str);
 void init_key_hash_table(KeyHashTable* table);
 void print_key_hash_table(KeyHashTable* table);
 void insert_key(KeyHashTable* table, Token key, size_t l_str, KeyNode* kn);
@@ -86,17 +134,16 @@ void breakdown_key_hash_table(KeyHashTable* table);
 void print_key_node(KeyNode* kn);
 
 // rule_hash_table.c
-int hash_rule(Rule* rule, size_t l_str);
+uint64_t hash_rule(size_t suffix, size_t l_str);
 void init_rule_hash_table(RuleHashTable* table);
-// void print_rule_hash_table(RuleHashTable* table);
-void insert_rule(RuleHashTable* table, Rule* rule, size_t l_str, RuleNode* rn);
-int rule_list_equals(RuleNode* head, Rule* rule);
-RuleNode* get_rule(RuleHashTable* table, Rule* rule, size_t l_str);
+void print_rule_hash_table(RuleHashTable* table);
+void insert_rule(RuleHashTable* table, size_t suffix, size_t l_str, RuleNode* rn);
+RuleNode* get_rule(RuleHashTable* table, size_t suffix, size_t l_str);
 void breakdown_rule_hash_table(RuleHashTable* table);
 void print_rule_node(RuleNode* rn);
 
 // grammar_hash_table.c
-int hash(Token key);
+uint64_t hash(Token key);
 void print_grammar_hash_table(GrammarHashTable* table);
 int insert_grammar(GrammarHashTable* table, GrammarHashTableVal* ts);
 GrammarHashTableVal* get_grammar(GrammarHashTable* table, Token key);
@@ -106,5 +153,7 @@ void breakdown_grammar_hash_table(GrammarHashTable* table);
 void insert_token_str(GrammarHashTable* table, Token key, 
     char* str, int strlen);
 void init_grammar_hash_table(GrammarHashTable* table);
+void init_grammar_hash_table_from_file(GrammarHashTable* table, 
+    const GrammarFile* gf);
 
 #endif // HASH_H
\ No newline at end of file
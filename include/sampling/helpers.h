@@ -4,32 +4,39 @@
 #include "sampling.h"
 
 /**
- * @brief Create a KeyNode object on the stack and return a pointer to it.
+ * @brief Create a KeyNode object in an arena and return a pointer to it.
  * A KeyNode object has (key, l_str) as its primary key – that is, a new
  * KeyNode object is created for a new combination of (key, l_str).
  * 
+ * @param arena The arena to allocate the KeyNode from. It is freed with the 
+ *      arena.
  * @param key Represents the token associated with `key`.
  * @param l_str The length of the string we want to produce.
  * @param count The number of strings of length `l_str` that `key` can produce.
  * @param rules A pointer to a linked list of `RuleNode` structs, representing 
  *      the rules associated with `key`.
- * @return KeyNode* A pointer to a new `KeyNode` object.
+ * @return KeyNode* A pointer to a new `KeyNode` object, or NULL if the arena 
+ *      could not grow.
  */
-KeyNode* create_key_node(Token key, size_t l_str, int count, RuleNode* rules);
+KeyNode* create_key_node(Arena* arena, Token key, size_t l_str, int count, 
+    RuleNode* rules);
 
 /**
- * @brief Create a RuleNode object on the stack and return a pointer to it. 
+ * @brief Create a RuleNode object in an arena and return a pointer to it. 
  * A RuleNode object has (key, l_str) as its primary key – that is, a new
  * RuleNode object is created for a new combination of (key, l_str).
  * 
+ * @param arena The arena to allocate the RuleNode from. It is freed with the 
+ *      arena.
  * @param key A pointer to a `KeyNode` struct, representing the head or 
  *      starting point of the rule.
  * @param tail A pointer to the tail or continuation of the rule. 
  * @param l_str The length of the string we want to produce.
  * @param count The number of strings of length `l_str` that `key` can produce. 
- * @return RuleNode* A pointer to a new RuleNode object.
+ * @return RuleNode* A pointer to a new RuleNode object, or NULL if the arena 
+ *      could not grow.
  */
-RuleNode* create_rule_node(KeyNode* key, RuleNode* tail, 
+RuleNode* create_rule_node(Arena* arena, KeyNode* key, RuleNode* tail, 
                             size_t l_str, int count);
 
 /**
@@ -87,10 +94,6 @@ DynTokenArray* concat_dta_lists(DynTokenArray* list1, DynTokenArray* list2);
 
 void free_token_array(DynTokenArray* arr);
 
-void free_key_node(KeyNode* kn);
-
-void free_rule_node(RuleHashTableVal* val);
-
 void print_dta(DynTokenArray* dta);
 
 void print_list_of_dtas(DynTokenArray* head);
@@ -2,9 +2,54 @@
 #define SAMPLING_H 
 
 #include "../grammar.h"
+#include "../rng.h"
 #include "hash.h"
+#include "bounds.h"
+#include "arena.h"
 #include <time.h>
 
+/**
+ * Everything the sampler needs for one grammar: the terminal strings and
+ * lengths, the length bounds, the memo of KeyNodes and RuleNodes, and the
+ * arena they are allocated from. Contexts share no state, so several grammars
+ * or lengths can be sampled side by side in one process, e.g., one context
+ * per thread.
+ */
+typedef struct SamplerContext
+{
+    const Grammar* grammar;         // The grammar sampled from. It must outlive the context.
+    GrammarHashTable grammar_hash;  // The string and length of every token.
+    LengthBounds length_bounds;     // Limits the lengths each symbol is tried at.
+    KeyHashTable key_strs;          // Memo of KeyNodes by (key, l_str).
+    RuleHashTable rule_strs;        // Memo of RuleNodes by (rule suffix, l_str).
+    Arena arena;                    // Allocates every memoized node.
+    int failed;                     // Set once the arena could not grow, until the context is reset.
+} SamplerContext;
+
+/**
+ * @brief Prepares a SamplerContext for the grammar of a loaded grammar file.
+ * 
+ * @param ctx The SamplerContext to initialise.
+ * @param gf The grammar file to sample from. It must outlive the context.
+ * @return int `0` on success, otherwise `-1`.
+ * 
+ * @see reset_sampler_context, breakdown_sampler_context
+ */
+int init_sampler_context(SamplerContext* ctx, const GrammarFile* gf);
+
+/**
+ * @brief Empties the memo of a SamplerContext, e.g., before sampling at 
+ * another length, or after an allocation has failed. Every KeyNode and 
+ * RuleNode from it is invalid afterwards, but the arena keeps its chunks for
+ * the next length.
+ */
+void reset_sampler_context(SamplerContext* ctx);
+
+/**
+ * @brief Frees everything owned by a SamplerContext.
+ */
+void breakdown_sampler_context(SamplerContext* ctx);
+
 /**
  * @brief Retrieves or computes the definition of a non-terminal or terminal key
  * in the grammar given a specific string length. A definition is characterised 
@@ -17,26 +62,24 @@
  * the definition. If the key is a terminal, it checks if the provided length 
  * `l_str` matches the length of the corresponding string in the grammar.
  * 
+ * @param ctx The SamplerContext of the grammar, which memoizes the result.
  * @param key The token representing the non-terminal or terminal key for which
  *      the definition needs to be retrieved or computed.
- * @param grammar A pointer to the Grammar structure containing non-terminals 
- *      and their rules.
  * @param l_str The length of the string to be produced by the key.
  * 
  * @return KeyNode* A pointer to the KeyNode representing the definition of the 
  *      specified key. If the key is not found or the length mismatch occurs, 
- *      an appropriate empty KeyNode is created to indicate the result. 
- * 
- * @note It is the responsibility of the caller to free the memory allocated 
- *      for the KeyNode when it is no longer needed.
+ *      an appropriate empty KeyNode is created to indicate the result. NULL
+ *      if the arena could not grow, after which every call returns NULL 
+ *      until the context is reset.
  * 
- * @note This function requires the three hash tables `key_strs`, `rule_strs` 
- *      and `grammar_hash` to be defined as global variables in the calling 
- *      program.
+ * @note The KeyNode and every node it refers to are allocated from the 
+ *      context's arena, and are freed when the context is reset or broken 
+ *      down.
  * 
- * @see create_key_node, insert_key, get_key, rules_get_def, free_key_node
+ * @see create_key_node, insert_key, get_key, rules_get_def
  */
-KeyNode* key_get_def(Token key, Grammar* grammar, size_t l_str);
+KeyNode* key_get_def(SamplerContext* ctx, Token key, size_t l_str);
 
 /**
  * @brief Retrieves or computes the definition of a rule in the grammar given a 
@@ -54,23 +97,28 @@ KeyNode* key_get_def(Token key, Grammar* grammar, size_t l_str);
  * length and explores the combinations of subrules that can produce each 
  * portion.
  * 
+ * A rule which is a view into the grammar's token pool, e.g., from 
+ * `grammar_rule`, and each of its suffixes are memoized under the position of
+ * their first token in the pool, so suffixes are never copied or hashed token
+ * by token.
+ * 
+ * @param ctx The SamplerContext of the grammar, which memoizes the result.
  * @param rule A pointer to the Rule structure representing the production rule 
  *      to be analysed.
- * @param grammar A pointer to the Grammar structure containing non-terminals 
- *      and their rules.
  * @param l_str The length of the string to be produced by the rule.
  * 
  * @return RuleNode* A pointer to the RuleNode representing the definition of 
  *      the specified rule for the given string length. If the rule is unable 
  *      to produce strings of the desired length, or if the result is memoized
- *      as empty, the function returns NULL.
+ *      as empty, the function returns NULL. It also returns NULL if the arena
+ *      could not grow, in which case `ctx->failed` is set.
  * 
- * @note It is the responsibility of the caller to free the memory allocated 
- *      for the RuleNode when it is no longer needed.
+ * @note The RuleNodes are allocated from the context's arena, and are freed 
+ *      when the context is reset or broken down.
  * 
- * @see key_get_def, create_rule_node, insert_rule, get_rule, free_rule_node
+ * @see key_get_def, create_rule_node, insert_rule, get_rule
  */
-RuleNode* rules_get_def(Rule* rule, Grammar* grammar, size_t l_str);
+RuleNode* rules_get_def(SamplerContext* ctx, Rule* rule, size_t l_str);
 
 /**
  * @brief Retrieves the total count of strings that a KeyNode can produce.
@@ -156,9 +204,8 @@ DynTokenArray* rule_extract_strings(RuleNode* rn);
  * @note It is the responsibility of the caller to free the memory allocated 
  *      for the DTA when it is no longer needed.
  * 
- * @note This function requires the three hash tables `key_strs`, `rule_strs` 
- *      and `grammar_hash` to be defined as global variables in the calling 
- *      program.
+ * @note This function only reads the KeyNode, so it needs no SamplerContext,
+ *      but the context `kn` came from must not have been reset since.
  * 
  * @see rule_get_string_at
  */
@@ -191,25 +238,23 @@ DynTokenArray* key_get_string_at(KeyNode* kn, int at);
 DynTokenArray* rule_get_string_at(RuleNode* rn, int at);
 
 /**
- * Uniformly at random samples a string of length `l_str` from the `grammar` 
- * starting from the specified `key`.
- * 
- * Ensure to set the seed of the rand() function in your calling function using
- * `srand((unsigned int)time(NULL));` to ensure randomness.
+ * Uniformly at random samples a string of length `l_str` from the context's
+ * grammar starting from the specified `key`.
  * 
+ * @param ctx The SamplerContext of the grammar.
  * @param key The starting key for sampling.
- * @param grammar Pointer to the Grammar structure.
  * @param l_str The desired length of the sampled string.
+ * @param rng The generator to draw the index of the string from. Seed it
+ *      with `rng_seed`, e.g., with `time(NULL)` for a different string on
+ *      every run.
  * 
  * @return DynTokenArray* A dynamically allocated single TokenArray representing 
- *      the sampled string.
+ *      the sampled string, or NULL if there is no string of length `l_str` or
+ *      the arena could not grow.
  * 
  * @see key_get_def, key_get_string_at
- * 
- * @note This function requires the three hash tables `key_strs`, `rule_strs` 
- *      and `grammar_hash` to be defined as global variables in the calling 
- *      program.
  */
-DynTokenArray* string_sample_UAR(Token key, Grammar* grammar, size_t l_str);
+DynTokenArray* string_sample_UAR(SamplerContext* ctx, Token key, size_t l_str,
+    Rng* rng);
 
 #endif // SAMPLING.h
\ No newline at end of file
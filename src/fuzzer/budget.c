@@ -0,0 +1,101 @@
+#include "../../include/fuzzer/budget.h"
+
+#include <string.h>
+
+// Adds two costs, saturating at COST_INF.
+static size_t add_costs(size_t a, size_t b)
+{
+    if (a == COST_INF || b == COST_INF || a > COST_INF - b)
+        return COST_INF;
+    return a + b;
+}
+
+static size_t rule_cost(const MinCostTable* table, Rule rule)
+{
+    size_t cost = 0;
+    for (size_t i = 0; i < rule.num_tokens; i++)
+    {
+        cost = add_costs(cost, key_min_cost(table, rule.tokens[i]));
+    }
+    return cost;
+}
+
+int init_min_cost_table(MinCostTable* table, const Grammar* grammar,
+    const uint32_t* terminal_costs, size_t num_terminals)
+{
+    memset(table, 0, sizeof(MinCostTable));
+    table->grammar = grammar;
+
+    // Terminal keys are dense from 0, so the largest one sizes the table.
+    table->num_terminals = num_terminals;
+    for (size_t pos = 0; pos < grammar->num_tokens; pos++)
+    {
+        Token key = grammar->tokens[pos];
+        if (is_non_terminal(key) == -1 && (size_t) key + 1 > table->num_terminals)
+            table->num_terminals = (size_t) key + 1;
+    }
+
+    size_t num_nt = grammar->num_non_terminals;
+    table->key_min = malloc((num_nt + 1) * sizeof(size_t));
+    table->rule_min = malloc((grammar->num_rules + 1) * sizeof(size_t));
+    table->cheapest_rule = malloc((num_nt + 1) * sizeof(uint32_t));
+    table->terminal_cost = malloc((table->num_terminals + 1) * sizeof(size_t));
+    if (table->key_min == NULL || table->rule_min == NULL
+        || table->cheapest_rule == NULL || table->terminal_cost == NULL)
+    {
+        breakdown_min_cost_table(table);
+        return -1;
+    }
+
+    for (size_t key = 0; key < table->num_terminals; key++)
+    {
+        table->terminal_cost[key] = terminal_costs == NULL ? 1
+            : key < num_terminals ? terminal_costs[key] : COST_INF;
+    }
+
+    for (size_t nt = 0; nt < num_nt; nt++)
+    {
+        table->key_min[nt] = COST_INF;
+        table->cheapest_rule[nt] = grammar_first_rule(grammar, nt);
+    }
+
+    // Costs only ever decrease, so iterate until none changes. The cheapest
+    // rule is only replaced by a strictly cheaper one, so it is always a rule
+    // whose non-terminals reached their final cost earlier. Following the
+    // cheapest rules therefore can never loop.
+    int changed = 1;
+    while (changed)
+    {
+        changed = 0;
+        for (size_t nt = 0; nt < num_nt; nt++)
+        {
+            size_t first_rule = grammar_first_rule(grammar, nt);
+            for (size_t r = 0; r < grammar_num_rules(grammar, nt); r++)
+            {
+                size_t cost = rule_cost(table, grammar_rule(grammar, first_rule + r));
+                if (cost < table->key_min[nt])
+                {
+                    table->key_min[nt] = cost;
+                    table->cheapest_rule[nt] = first_rule + r;
+                    changed = 1;
+                }
+            }
+        }
+    }
+
+    for (size_t r = 0; r < grammar->num_rules; r++)
+    {
+        table->rule_min[r] = rule_cost(table, grammar_rule(grammar, r));
+    }
+
+    return 0;
+}
+
+void breakdown_min_cost_table(MinCostTable* table)
+{
+    free(table->key_min);
+    free(table->rule_min);
+    free(table->cheapest_rule);
+    free(table->terminal_cost);
+    memset(table, 0, sizeof(MinCostTable));
+}
@@ -1,4 +1,6 @@
+import os
 import json
+import struct
 import argparse
 
 parser = argparse.ArgumentParser(
@@ -13,22 +15,83 @@ parser.add_argument(
 parser.add_argument(
     '--debug', 
     action='store_true', 
-    help='Output C Grammar struct with strings instead of 8-bit keys'
+    help='Output C Grammar struct with strings instead of token keys'
+)
+parser.add_argument(
+    '--codegen', 
+    action='store_true', 
+    help='Output a C source file with a specialised generator function per non-terminal'
+)
+parser.add_argument(
+    '--token-bits', 
+    type=int, 
+    choices=[8, 16, 32], 
+    default=8, 
+    help='Width of a token in bits; must match TOKEN_BITS in the C build (default: 8)'
+)
+parser.add_argument(
+    '--binary', 
+    action='store_true', 
+    help='Output a binary grammar file to be loaded at runtime instead of a C Grammar struct'
 )
 
 args = parser.parse_args()
 
 # True: outputs a C representation of the grammar with strings instead of keys.
-# False (default): outputs a C representation of the grammar using 8-bit keys.
+# False (default): outputs a C representation of the grammar using keys.
 if args.debug:
     TO_STRING = True
 else:
     TO_STRING = False
 
+# Non-terminal keys have the MSB set. The all-ones key is reserved by the C
+# library as a sentinel.
+TOKEN_BITS = args.token_bits
+NON_TERMINAL_FLAG = 1 << (TOKEN_BITS - 1)
+MAX_NON_TERMINALS = NON_TERMINAL_FLAG - 1
+MAX_TERMINALS = NON_TERMINAL_FLAG
+
 FILEPATH = args.file_path
 with open(FILEPATH, "r") as f:
     grammar = json.load(f)
 
+def split_weights(grammar: dict) -> tuple:
+    '''
+    A rule is either a list of tokens, or an object giving the tokens and the
+    weight with which the fuzzer picks the rule, e.g.
+        {"tokens": ["<noun>", "s"], "weight": 2.5}
+    Rules without a weight have weight 1.
+
+    Returns the grammar with every rule as a plain list of tokens, and the
+    weights of the rules of each non-terminal in the same order.
+    '''
+    rules = {}
+    weights = {}
+    for nonterminal, alternatives in grammar.items():
+        if not alternatives:
+            raise SystemExit(
+                f"error: {nonterminal} has no rules; every non-terminal "
+                f"needs at least one"
+            )
+        rules[nonterminal] = []
+        weights[nonterminal] = []
+        for rule in alternatives:
+            weight = 1.0
+            if isinstance(rule, dict):
+                weight = rule.get("weight", 1.0)
+                rule = rule["tokens"]
+            if not isinstance(weight, (int, float)) or not weight >= 0:
+                raise SystemExit(
+                    f"error: a rule of {nonterminal} has invalid weight "
+                    f"{weight!r}; weights must be non-negative numbers"
+                )
+            rules[nonterminal].append(rule)
+            weights[nonterminal].append(float(weight))
+    return rules, weights
+
+grammar, weights = split_weights(grammar)
+WEIGHTED = any(w != 1.0 for ws in weights.values() for w in ws)
+
 def create_lookup_table(grammar) -> dict:
     # Order the tokens in the grammar
     ordered_nonterminals = []
@@ -40,17 +103,27 @@ def create_lookup_table(grammar) -> dict:
         for rule in grammar[nonterminal]:
             for token in rule:
                 if is_nonterminal(token):
-                    ordered_nonterminals.append(token)
-                else:
+                    if token not in ordered_nonterminals:
+                        ordered_nonterminals.append(token)
+                elif token not in ordered_terminals:
                     ordered_terminals.append(token)
     
-    # Assign an 8-bit key to each token in order
-    # i.e.  non-terminal 1 will be assigned 0x80
+    if (len(ordered_nonterminals) > MAX_NON_TERMINALS
+            or len(ordered_terminals) > MAX_TERMINALS):
+        raise SystemExit(
+            f"error: the grammar has {len(ordered_nonterminals)} non-terminals "
+            f"and {len(ordered_terminals)} terminals, which do not fit in "
+            f"{TOKEN_BITS}-bit tokens; use a larger --token-bits"
+        )
+
+    # Assign a dense key to each token in order, with the MSB set for
+    # non-terminals, i.e. for 8-bit tokens
+    #       non-terminal 1 will be assigned 0x80
     #       non-terminal 2 will be assigned 0x81
     #       terminal 1 will be assigned 0x00
     #       terminal 2 will be assigned 0x01
     lookup = {}
-    key_nt = 0x80
+    key_nt = NON_TERMINAL_FLAG
     key_t = 0x00
     for non_terminal in ordered_nonterminals:
         lookup[non_terminal] = key_nt
@@ -80,108 +153,256 @@ def export_grammar(grammar: dict, to_string: bool) -> None:
     if to_string:
         f = open("./data/grammar_c_str.txt", "w")
     else:
-        f = open("./data/grammar_c_8bit.txt", "w")
+        f = open(f"./data/grammar_c_{TOKEN_BITS}bit.txt", "w")
+
+    # The grammar is written in compressed-sparse-row form: one pool holding
+    # the tokens of every rule, the offset of each rule in that pool, and the
+    # offset of each non-terminal's first rule.
+    token_offsets = [0]
+    rule_offsets = [0]
+    for nonterminal in ordered_nt:
+        for rule in grammar[nonterminal]:
+            token_offsets.append(token_offsets[-1] + len(rule))
+        rule_offsets.append(len(token_offsets) - 1)
+
+    # The keys are only valid for a build with the same token width.
+    f.write(f"#if TOKEN_BITS != {TOKEN_BITS}\n")
+    f.write(f'#error "This grammar was generated for TOKEN_BITS={TOKEN_BITS}"\n')
+    f.write("#endif\n\n")
+
+    # Token pool {}
+    f.write("static const Token GRAMMAR_TOKENS[] = {\n")
+    for i, nonterminal in enumerate(ordered_nt):
+        for j, rule in enumerate(grammar[nonterminal]):
+            # Comment showing the rule being written
+            f.write("\t")
+            f.write(f"// {nonterminal} ::= {' '.join(rule)}\n")
+
+            f.write("\t")
+            if to_string:
+                f.write(", ".join(f'"{token}"' for token in rule))
+            else:
+                f.write(", ".join(hex(lookup[token]) for token in rule))
+
+            last_rule = (
+                i == len(ordered_nt) - 1
+                and j == len(grammar[nonterminal]) - 1
+            )
+            if not last_rule:
+                f.write(",")
+            f.write("\n")
+    f.write("};\n\n")
+
+    # Offset of each rule in the token pool {}
+    f.write("static const uint32_t GRAMMAR_TOKEN_OFFSETS[] = {")
+    f.write(", ".join(str(offset) for offset in token_offsets))
+    f.write("};\n\n")
+
+    # Offset of each non-terminal's first rule {}
+    f.write("static const uint32_t GRAMMAR_RULE_OFFSETS[] = {\n")
+    for i, offset in enumerate(rule_offsets):
+        f.write("\t")
+        f.write(str(offset))
+        if i != len(rule_offsets) - 1:
+            f.write(",")
+        if i < len(ordered_nt):
+            f.write(f"\t// {ordered_nt[i]}")
+        f.write("\n")
+    f.write("};\n\n")
+
+    # Weight of each rule, only written for weighted grammars {}
+    if WEIGHTED:
+        f.write("static const double GRAMMAR_RULE_WEIGHTS[] = {")
+        f.write(", ".join(repr(w) for nt in ordered_nt for w in weights[nt]))
+        f.write("};\n\n")
 
     # Main Grammar {}
     f.write("Grammar GRAMMAR = {\n")
-    
-    # Number of NonTerminals
     f.write("\t")
-    f.write(str(len(grammar)) + ",\n")
-    
-    # Array of NonTerminals
+    f.write(f"{len(ordered_nt)},\t// Number of non-terminals\n")
     f.write("\t")
-    f.write("{\n")
+    f.write(f"{len(token_offsets) - 1},\t// Number of rules\n")
+    f.write("\t")
+    f.write(f"{token_offsets[-1]},\t// Number of tokens\n")
+    f.write("\tGRAMMAR_RULE_OFFSETS,\n")
+    f.write("\tGRAMMAR_TOKEN_OFFSETS,\n")
+    f.write("\tGRAMMAR_TOKENS\n")
+    f.write("};")
+
+    f.close()
+
+# Must match GRAMMAR_FILE_MAGIC and GRAMMAR_FILE_VERSION in grammar_file.h.
+BINARY_MAGIC = b"GFZG"
+BINARY_VERSION = 2
+BINARY_HEADER = struct.Struct("<4s7I8Q")
+TOKEN_FORMAT = {8: "B", 16: "H", 32: "I"}
+
+def export_binary_grammar(grammar: dict) -> None:
+    '''
+    Writes the grammar in the binary format read by `load_grammar_file()`.
+    See `GrammarFileHeader` in include/grammar_file.h for the layout.
+    '''
+    lookup, ordered_nt, ordered_t = create_lookup_table(grammar)
 
+    tokens = []
+    token_offsets = [0]
+    rule_offsets = [0]
+    for nonterminal in ordered_nt:
+        for rule in grammar[nonterminal]:
+            tokens.extend(lookup[token] for token in rule)
+            token_offsets.append(len(tokens))
+        rule_offsets.append(len(token_offsets) - 1)
+
+    # Terminal strings come first in the string pool, followed by the names
+    # of the non-terminals. Every string is NUL-terminated.
+    strings = b""
+    terminal_lengths = []
+    terminal_strs = []
+    for terminal in ordered_t:
+        terminal_strs.append(len(strings))
+        terminal_lengths.append(len(terminal.encode()))
+        strings += terminal.encode() + b"\0"
+    terminal_strs.append(len(strings))
+
+    non_terminal_strs = []
+    for nonterminal in ordered_nt:
+        non_terminal_strs.append(len(strings))
+        strings += nonterminal.encode() + b"\0"
+    non_terminal_strs.append(len(strings))
+
+    sections = [
+        struct.pack(f"<{len(rule_offsets)}I", *rule_offsets),
+        struct.pack(f"<{len(token_offsets)}I", *token_offsets),
+        struct.pack(f"<{len(tokens)}{TOKEN_FORMAT[TOKEN_BITS]}", *tokens),
+        struct.pack(f"<{len(terminal_lengths)}I", *terminal_lengths),
+        struct.pack(f"<{len(terminal_strs)}I", *terminal_strs),
+        struct.pack(f"<{len(non_terminal_strs)}I", *non_terminal_strs),
+        strings,
+        struct.pack(f"<{len(token_offsets) - 1}d",
+            *(w for nt in ordered_nt for w in weights[nt])),
+    ]
+
+    # Lay the sections out after the header, each aligned to 8 bytes.
+    body = b""
+    section_offsets = []
+    for section in sections:
+        offset = BINARY_HEADER.size + len(body)
+        section_offsets.append(offset)
+        body += section + b"\0" * (-len(section) % 8)
+
+    header = BINARY_HEADER.pack(
+        BINARY_MAGIC,
+        BINARY_VERSION,
+        TOKEN_BITS,
+        len(ordered_nt),
+        len(ordered_t),
+        len(token_offsets) - 1, # Number of rules
+        len(tokens),
+        len(strings),
+        *section_offsets
+    )
+
+    with open("./data/grammar.bin", "wb") as f:
+        f.write(header + body)
+
+def generator_name(index: int, nonterminal: str) -> str:
+    '''
+    Returns a valid, unique C identifier for the generator of a non-terminal,
+    e.g. gen_2_noun_phrase for <noun_phrase>.
+    '''
+    name = "".join(c if c.isalnum() else "_" for c in nonterminal.strip("<>"))
+    return f"gen_{index}_{name}".rstrip("_")
+
+def export_generator(grammar: dict) -> None:
+    '''
+    Writes a C source file containing one generator function per non-terminal.
+    Each function holds a switch over its rules in which every token is
+    expanded inline: terminals are written straight to the output and
+    non-terminals call their own generator. The C compiler is then free to
+    inline and constant-fold the grammar, rather than `unify_key_inv`
+    interpreting the Grammar struct on every call.
+
+    The file defines `unify_key_inv_gen()`, declared in fuzzer.h.
+    '''
+    if WEIGHTED:
+        print("warning: rule weights are ignored by the generated code; "
+            "use --binary and init_rule_weights() for weighted fuzzing")
+
+    lookup, ordered_nt, ordered_t = create_lookup_table(grammar)
+    names = [generator_name(i, nt) for i, nt in enumerate(ordered_nt)]
+
+    def write_rule(f, rule, indent):
+        for token in rule:
+            f.write(indent)
+            if is_nonterminal(token):
+                index = ordered_nt.index(token)
+                f.write(f"if ({names[index]}(rng, fuzzed) != 0) return -1;\n")
+            else:
+                f.write(f"if (token_array_push(fuzzed, {hex(lookup[token])}) != 0) return -1;")
+                f.write(f"\t// {token}\n")
+
+    f = open("./data/grammar_gen.c", "w")
+
+    f.write(f"/* Generated by converter.py --codegen from {os.path.basename(FILEPATH)}. Do not edit. */\n\n")
+    f.write('#include "../include/fuzzer/fuzzer.h"\n\n')
+
+    # The keys are only valid for a build with the same token width.
+    f.write(f"#if TOKEN_BITS != {TOKEN_BITS}\n")
+    f.write(f'#error "This grammar was generated for TOKEN_BITS={TOKEN_BITS}"\n')
+    f.write("#endif\n\n")
+
+    # Forward declarations, as the generators are mutually recursive.
     for i, nonterminal in enumerate(ordered_nt):
-        # NonTerminal {}
-        f.write("\t\t")
+        f.write(f"static int {names[i]}(Rng* rng, TokenArray* fuzzed);\n")
+    f.write("\n")
+
+    for i, nonterminal in enumerate(ordered_nt):
+        rules = grammar[nonterminal]
+
+        f.write(f"// {nonterminal}\n")
+        f.write(f"static int {names[i]}(Rng* rng, TokenArray* fuzzed)\n")
         f.write("{\n")
 
-        # Name of NonTerminal
-        f.write("\t\t\t")
-        if to_string:
-            f.write(f'"{nonterminal}",\n') 
-        else:
-            f.write(f'// {nonterminal}\n')
-            f.write("\t\t\t")
-            f.write(f'{hex(lookup[nonterminal])},\n')
-
-        # Number of rules NonTerminal has
-        f.write("\t\t\t")
-        f.write(str(len(grammar[nonterminal])) + ",\n")
-
-        # Array of Rules for each NonTerminal {}
-        f.write("\t\t\t")
-        f.write("{\n") # array of rules
-
-        for j in range(len(grammar[nonterminal])):
-            rule = grammar[nonterminal][j]
-
-            # Rule {}
-            f.write("\t\t\t\t")
-            f.write("{\n")
-
-            if not to_string:
-                f.write("\t\t\t\t\t")
-                f.write("// ")
-                for k in range(len(rule)):
-                    token = rule[k]
-                    f.write(f'{token}')
-                    if k != len(rule) - 1:
-                        f.write(", ")
-                    else:
-                        f.write("\n")
-
-            # Number of tokens in rule
-            f.write("\t\t\t\t\t")
-            f.write(str(len(rule)) + ",\n")
-
-            # Token {}
-            f.write("\t\t\t\t\t")
-            f.write("{")
-            
-            for k in range(len(rule)):
-                token = rule[k]
-                
-                if to_string:
-                    f.write(f'"{token}"')
-                else:
-                    f.write(f'{hex(lookup[token])}')
-                
-                if k != len(rule) - 1:
-                    f.write(", ")
-
-            # Token {}                    
-            f.write("}\n")
-
-            # Rule {}
-            if j == len(grammar[nonterminal]) - 1:
-                f.write("\t\t\t\t")
-                f.write("}\n")
-            else:
-                f.write("\t\t\t\t")
-                f.write("},\n")
-        
-        # Array of Rules for each NonTerminal {}
-        f.write("\t\t\t")
-        f.write("}\n")
-
-        # NonTerminal {}
-        if i == len(grammar) - 1:
-            f.write("\t\t")
-            f.write("}\n")
+        if len(rules) == 1:
+            # No choice to be made, so no random number is drawn.
+            f.write(f"\t// {nonterminal} ::= {' '.join(rules[0])}\n")
+            write_rule(f, rules[0], "\t")
         else:
-            f.write("\t\t")
-            f.write("},\n")
-    
-    # Array of NonTerminals {}
-    f.write("\t")
-    f.write("}\n")
+            f.write(f"\tswitch (rng_bounded(rng, {len(rules)}))\n")
+            f.write("\t{\n")
+            for j, rule in enumerate(rules):
+                f.write(f"\tcase {j}:\t// {nonterminal} ::= {' '.join(rule)}\n")
+                write_rule(f, rule, "\t\t")
+                f.write("\t\tbreak;\n")
+            f.write("\t}\n")
 
-    # Grammar {}
-    f.write("};")    
+        f.write("\treturn 0;\n")
+        f.write("}\n\n")
+
+    # Entry point mapping a key to its generator.
+    f.write("int unify_key_inv_gen(Token key, Rng* rng, TokenArray* fuzzed)\n")
+    f.write("{\n")
+    f.write("\tint ret;\n")
+    f.write("\tswitch (key)\n")
+    f.write("\t{\n")
+    for i, nonterminal in enumerate(ordered_nt):
+        f.write(f"\tcase {hex(lookup[nonterminal])}:\n")
+        f.write(f"\t\tret = {names[i]}(rng, fuzzed);\n")
+        f.write("\t\tbreak;\n")
+    f.write("\tdefault:\n")
+    f.write("\t\t// The only string which a terminal symbol can generate is\n")
+    f.write("\t\t// the symbol itself.\n")
+    f.write("\t\tret = token_array_push(fuzzed, key);\n")
+    f.write("\t\tbreak;\n")
+    f.write("\t}\n")
+    f.write("\treturn ret != 0 ? ret : flush_token_array(fuzzed);\n")
+    f.write("}\n")
 
     f.close()
 
-export_grammar(grammar, to_string=TO_STRING)
\ No newline at end of file
+if args.binary:
+    export_binary_grammar(grammar)
+elif args.codegen:
+    export_generator(grammar)
+else:
+    export_grammar(grammar, to_string=TO_STRING)
\ No newline at end of file
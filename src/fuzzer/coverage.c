@@ -0,0 +1,88 @@
+#include "../../include/fuzzer/coverage.h"
+
+#include <inttypes.h>
+#include <string.h>
+
+int init_rule_coverage(RuleCoverage* cov, const Grammar* grammar)
+{
+    cov->grammar = grammar;
+    cov->hits = calloc(grammar->num_rules + 1, sizeof(uint8_t));
+    cov->totals = calloc(grammar->num_rules + 1, sizeof(uint64_t));
+    cov->biased = malloc((grammar->num_rules + 1) * sizeof(double));
+    if (cov->hits == NULL || cov->totals == NULL || cov->biased == NULL)
+    {
+        breakdown_rule_coverage(cov);
+        return -1;
+    }
+    return 0;
+}
+
+void breakdown_rule_coverage(RuleCoverage* cov)
+{
+    free(cov->hits);
+    free(cov->totals);
+    free(cov->biased);
+    memset(cov, 0, sizeof(RuleCoverage));
+}
+
+void clear_rule_coverage(RuleCoverage* cov)
+{
+    memset(cov->hits, 0, cov->grammar->num_rules);
+    memset(cov->totals, 0, cov->grammar->num_rules * sizeof(uint64_t));
+}
+
+void merge_rule_coverage(RuleCoverage* dst, const RuleCoverage* src)
+{
+    for (size_t r = 0; r < dst->grammar->num_rules; r++)
+    {
+        dst->totals[r] += rule_coverage_hits(src, r);
+    }
+}
+
+size_t rule_coverage_count(const RuleCoverage* cov)
+{
+    size_t count = 0;
+    for (size_t r = 0; r < cov->grammar->num_rules; r++)
+    {
+        count += rule_coverage_hits(cov, r) != 0;
+    }
+    return count;
+}
+
+int bias_rule_weights(RuleCoverage* cov, const double* base_weights,
+    RuleWeights* rw)
+{
+    for (size_t r = 0; r < cov->grammar->num_rules; r++)
+    {
+        double base = base_weights != NULL ? base_weights[r] : 1;
+        cov->biased[r] = base / (1 + (double) rule_coverage_hits(cov, r));
+    }
+    return update_rule_weights(rw, cov->biased);
+}
+
+int write_rule_coverage(const RuleCoverage* cov, const GrammarFile* gf,
+    FILE* out)
+{
+    const Grammar* grammar = cov->grammar;
+    for (size_t nt = 0; nt < grammar->num_non_terminals; nt++)
+    {
+        size_t first_rule = grammar_first_rule(grammar, nt);
+        for (size_t r = 0; r < grammar_num_rules(grammar, nt); r++)
+        {
+            Rule rule = grammar_rule(grammar, first_rule + r);
+            write_grammar_file_token(gf, NON_TERMINAL(nt), out);
+            fprintf(out, " ::=");
+            for (size_t i = 0; i < rule.num_tokens; i++)
+            {
+                fputc(' ', out);
+                write_grammar_file_token(gf, rule.tokens[i], out);
+            }
+            fprintf(out, "\t%" PRIu64 "\n",
+                rule_coverage_hits(cov, first_rule + r));
+        }
+    }
+
+    fprintf(out, "Covered %zu of %zu rules\n", rule_coverage_count(cov),
+        grammar->num_rules);
+    return ferror(out) ? -1 : 0;
+}
@@ -0,0 +1,322 @@
+#include "../../include/fuzzer/derivation.h"
+
+#include <string.h>
+
+// The number of nodes or cursors allocated when an empty arena or stack
+// first needs space.
+#define INITIAL_CAPACITY 64
+
+int init_derivation_tree(DerivationTree* tree, const Grammar* grammar,
+    size_t capacity)
+{
+    memset(tree, 0, sizeof(DerivationTree));
+    tree->grammar = grammar;
+    tree->root = DERIVATION_NONE;
+    if (capacity >= DERIVATION_NONE)
+        return -1;
+    if (capacity > 0)
+    {
+        tree->nodes = malloc(capacity * sizeof(DerivationNode));
+        if (tree->nodes == NULL)
+            return -1;
+        tree->capacity = capacity;
+    }
+    return 0;
+}
+
+void breakdown_derivation_tree(DerivationTree* tree)
+{
+    free(tree->nodes);
+    free(tree->stack);
+    memset(tree, 0, sizeof(DerivationTree));
+    tree->root = DERIVATION_NONE;
+}
+
+void clear_derivation_tree(DerivationTree* tree)
+{
+    tree->num_nodes = 0;
+    tree->root = DERIVATION_NONE;
+    tree->num_tokens = 0;
+}
+
+int reserve_derivation_tree(DerivationTree* tree, size_t num_nodes)
+{
+    // The last index is kept free, as it doubles as DERIVATION_NONE.
+    if (num_nodes > DERIVATION_NONE - 1 - tree->num_nodes)
+        return -1;
+    size_t needed = tree->num_nodes + num_nodes;
+    if (needed <= tree->capacity)
+        return 0;
+
+    size_t capacity = tree->capacity ? (size_t) tree->capacity * 2 : INITIAL_CAPACITY;
+    if (capacity < needed)
+        capacity = needed;
+    if (capacity > DERIVATION_NONE - 1)
+        capacity = DERIVATION_NONE - 1;
+    DerivationNode* nodes = realloc(tree->nodes, capacity * sizeof(DerivationNode));
+    if (nodes == NULL)
+        return -1;
+    tree->nodes = nodes;
+    tree->capacity = capacity;
+    return 0;
+}
+
+uint32_t add_derivation_node(DerivationTree* tree, uint32_t parent,
+    uint32_t prev_sibling, Token symbol, uint32_t rule, uint32_t token_start)
+{
+    if (tree->num_nodes == tree->capacity && reserve_derivation_tree(tree, 1) != 0)
+        return DERIVATION_NONE;
+
+    uint32_t index = tree->num_nodes++;
+    tree->nodes[index] = (DerivationNode) {
+        rule, DERIVATION_NONE, DERIVATION_NONE, token_start, 0, symbol
+    };
+
+    if (parent == DERIVATION_NONE)
+        tree->root = index;
+    else if (prev_sibling == DERIVATION_NONE)
+        tree->nodes[parent].first_child = index;
+    else
+        tree->nodes[prev_sibling].next_sibling = index;
+    return index;
+}
+
+void finish_derivation_tree(DerivationTree* tree, uint32_t first_node)
+{
+    // Children are always added after their parent, so walking the arena
+    // backwards finishes every child before its parent.
+    for (uint32_t i = tree->num_nodes; i-- > first_node;)
+    {
+        DerivationNode* node = &tree->nodes[i];
+        for (uint32_t c = node->first_child; c != DERIVATION_NONE;
+            c = tree->nodes[c].next_sibling)
+        {
+            node->token_len += tree->nodes[c].token_len;
+        }
+    }
+}
+
+int copy_derivation_tree(DerivationTree* dst, const DerivationTree* src)
+{
+    clear_derivation_tree(dst);
+    if (reserve_derivation_tree(dst, src->num_nodes) != 0)
+        return -1;
+    memcpy(dst->nodes, src->nodes, src->num_nodes * sizeof(DerivationNode));
+    dst->num_nodes = src->num_nodes;
+    dst->root = src->root;
+    dst->num_tokens = src->num_tokens;
+    return 0;
+}
+
+uint32_t derivation_subtree_end(const DerivationTree* tree, uint32_t node)
+{
+    // In pre-order, the last node of a subtree is found by following the
+    // last child down to a leaf.
+    const DerivationNode* nodes = tree->nodes;
+    while (nodes[node].first_child != DERIVATION_NONE)
+    {
+        node = nodes[node].first_child;
+        while (nodes[node].next_sibling != DERIVATION_NONE)
+            node = nodes[node].next_sibling;
+    }
+    return node + 1;
+}
+
+uint32_t append_derivation_nodes(DerivationTree* dst, const DerivationTree* src,
+    uint32_t begin, uint32_t end)
+{
+    uint32_t count = end - begin;
+    if (reserve_derivation_tree(dst, count) != 0)
+        return DERIVATION_NONE;
+
+    // `src` may be `dst`, whose nodes have only now stopped moving.
+    uint32_t base = dst->num_nodes;
+    memcpy(dst->nodes + base, src->nodes + begin, count * sizeof(DerivationNode));
+    dst->num_nodes += count;
+
+    for (DerivationNode* n = dst->nodes + base; n != dst->nodes + base + count; n++)
+    {
+        if (n->first_child != DERIVATION_NONE)
+            n->first_child = n->first_child - begin + base;
+        if (n->next_sibling != DERIVATION_NONE)
+            n->next_sibling = n->next_sibling - begin + base;
+    }
+    return base;
+}
+
+// Makes room on the walking stack for a cursor at `depth`.
+static int grow_stack(DerivationTree* tree, size_t depth)
+{
+    if (depth < tree->stack_capacity)
+        return 0;
+    size_t capacity = tree->stack_capacity ? tree->stack_capacity * 2 : INITIAL_CAPACITY;
+    DerivationCursor* stack = realloc(tree->stack, capacity * sizeof(DerivationCursor));
+    if (stack == NULL)
+        return -1;
+    tree->stack = stack;
+    tree->stack_capacity = capacity;
+    return 0;
+}
+
+// Pushes a cursor at the start of `node`'s rule onto the walking stack.
+static int push_cursor(DerivationTree* tree, size_t* depth, uint32_t node)
+{
+    if (grow_stack(tree, *depth) != 0)
+        return -1;
+
+    // A terminal root derives just itself.
+    DerivationNode* n = &tree->nodes[node];
+    const Token* begin = &n->symbol;
+    const Token* end = &n->symbol + 1;
+    if (n->rule != DERIVATION_NONE)
+    {
+        Rule rule = grammar_rule(tree->grammar, n->rule);
+        begin = rule.tokens;
+        end = rule.tokens + rule.num_tokens;
+    }
+    tree->stack[(*depth)++] = (DerivationCursor) {begin, end, node, n->first_child};
+    return 0;
+}
+
+int compact_derivation_tree(DerivationTree* dst, const DerivationTree* src)
+{
+    clear_derivation_tree(dst);
+    dst->num_tokens = src->num_tokens;
+    if (src->root == DERIVATION_NONE)
+        return 0;
+    if (reserve_derivation_tree(dst, src->num_nodes) != 0 || grow_stack(dst, 0) != 0)
+        return -1;
+
+    // Each cursor holds the copy of a node and the next child of the
+    // original to copy. A copy's first child directly follows it, and its
+    // next sibling follows its last descendant.
+    size_t depth = 0;
+    uint32_t root = src->root;
+    dst->root = dst->num_nodes++;
+    dst->nodes[0] = src->nodes[root];
+    dst->nodes[0].next_sibling = DERIVATION_NONE;
+    if (dst->nodes[0].first_child != DERIVATION_NONE)
+        dst->nodes[0].first_child = 1;
+    dst->stack[depth++] = (DerivationCursor) {NULL, NULL, 0, src->nodes[root].first_child};
+
+    while (depth > 0)
+    {
+        DerivationCursor* top = &dst->stack[depth - 1];
+        uint32_t child = top->child;
+        if (child == DERIVATION_NONE)
+        {
+            DerivationNode* copy = &dst->nodes[top->node];
+            if (copy->next_sibling != DERIVATION_NONE)
+                copy->next_sibling = dst->num_nodes;
+            depth--;
+            continue;
+        }
+
+        top->child = src->nodes[child].next_sibling;
+        uint32_t index = dst->num_nodes++;
+        DerivationNode* copy = &dst->nodes[index];
+        *copy = src->nodes[child];
+        if (copy->first_child != DERIVATION_NONE)
+            copy->first_child = index + 1;
+        if (grow_stack(dst, depth) != 0)
+            return -1;
+        dst->stack[depth++] = (DerivationCursor) {NULL, NULL, index, src->nodes[child].first_child};
+    }
+
+    return 0;
+}
+
+int derivation_tree_string(DerivationTree* tree, TokenArray* out)
+{
+    tree->num_tokens = 0;
+    if (tree->root == DERIVATION_NONE)
+        return flush_token_array(out);
+
+    size_t depth = 0;
+    tree->nodes[tree->root].token_start = 0;
+    if (push_cursor(tree, &depth, tree->root) != 0)
+        return -1;
+
+    while (depth > 0)
+    {
+        DerivationCursor* top = &tree->stack[depth - 1];
+        if (top->next == top->end)
+        {
+            DerivationNode* node = &tree->nodes[top->node];
+            node->token_len = tree->num_tokens - node->token_start;
+            depth--;
+            continue;
+        }
+
+        Token key = *top->next++;
+        if (is_non_terminal(key) == -1)
+        {
+            if (tree->num_tokens == UINT32_MAX || token_array_push(out, key) != 0)
+                return -1;
+            tree->num_tokens++;
+            continue;
+        }
+
+        // The children of a node follow the non-terminals of its rule.
+        uint32_t child = top->child;
+        if (child == DERIVATION_NONE)
+            return -1;
+        top->child = tree->nodes[child].next_sibling;
+        tree->nodes[child].token_start = tree->num_tokens;
+        if (push_cursor(tree, &depth, child) != 0)
+            return -1;
+    }
+
+    return flush_token_array(out);
+}
+
+// Writes the line of one node at the given depth.
+static void write_node(const DerivationTree* tree, uint32_t index,
+    size_t depth, const GrammarFile* gf, FILE* out)
+{
+    const DerivationNode* node = &tree->nodes[index];
+    fprintf(out, "%*s", (int) (2 * depth), "");
+    write_grammar_file_token(gf, node->symbol, out);
+    if (node->rule != DERIVATION_NONE)
+    {
+        Rule rule = grammar_rule(tree->grammar, node->rule);
+        fprintf(out, " ::=");
+        for (size_t i = 0; i < rule.num_tokens; i++)
+        {
+            fputc(' ', out);
+            write_grammar_file_token(gf, rule.tokens[i], out);
+        }
+    }
+    fprintf(out, "\t[%u, %u)\n", node->token_start,
+        node->token_start + node->token_len);
+}
+
+int write_derivation_tree(DerivationTree* tree, const GrammarFile* gf,
+    FILE* out)
+{
+    if (tree->root == DERIVATION_NONE)
+        return 0;
+
+    size_t depth = 0;
+    if (push_cursor(tree, &depth, tree->root) != 0)
+        return -1;
+    write_node(tree, tree->root, 0, gf, out);
+
+    // Only the links between nodes are followed, not the rules' tokens.
+    while (depth > 0)
+    {
+        DerivationCursor* top = &tree->stack[depth - 1];
+        uint32_t child = top->child;
+        if (child == DERIVATION_NONE)
+        {
+            depth--;
+            continue;
+        }
+        top->child = tree->nodes[child].next_sibling;
+        write_node(tree, child, depth, gf, out);
+        if (push_cursor(tree, &depth, child) != 0)
+            return -1;
+    }
+
+    return ferror(out) ? -1 : 0;
+}
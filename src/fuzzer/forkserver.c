@@ -0,0 +1,196 @@
+#include "../../include/fuzzer/forkserver.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <signal.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/shm.h>
+#include <sys/wait.h>
+#include <time.h>
+#include <unistd.h>
+
+static uint64_t now_ms(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t) ts.tv_sec * 1000 + ts.tv_nsec / 1000000;
+}
+
+// Reads one 4 byte reply from the fork server, waiting for at most
+// `timeout_ms`, or forever if it is 0. Returns 0 on success, 1 if the time
+// ran out, otherwise -1 if the fork server has gone away.
+static int read_reply(const ForkServer* fs, int32_t* value, unsigned timeout_ms)
+{
+    if (timeout_ms != 0)
+    {
+        uint64_t deadline = now_ms() + timeout_ms;
+        struct pollfd pfd = {fs->status_fd, POLLIN, 0};
+        int ready;
+        while ((ready = poll(&pfd, 1, (int) (deadline - now_ms()))) < 0)
+        {
+            if (errno != EINTR)
+                return -1;
+            if (now_ms() >= deadline)
+                return 1;
+        }
+        if (ready == 0)
+            return 1;
+    }
+
+    uint8_t* bytes = (uint8_t*) value;
+    for (size_t done = 0; done < sizeof(*value);)
+    {
+        ssize_t ret = read(fs->status_fd, bytes + done, sizeof(*value) - done);
+        if (ret < 0 && errno == EINTR)
+            continue;
+        if (ret <= 0)
+            return -1;
+        done += ret;
+    }
+    return 0;
+}
+
+// Moves `fd` to `target` in the target's process.
+static int move_fd(int fd, int target)
+{
+    if (fd == target)
+        return 0;
+    if (dup2(fd, target) < 0)
+        return -1;
+    return close(fd);
+}
+
+int init_fork_server(ForkServer* fs, char* const argv[], size_t max_length,
+    unsigned timeout_ms)
+{
+    memset(fs, 0, sizeof(ForkServer));
+    fs->pid = -1;
+    fs->control_fd = -1;
+    fs->status_fd = -1;
+    fs->shm_id = -1;
+    fs->max_length = max_length;
+    if (max_length > UINT32_MAX)
+        return -1;
+
+    fs->shm_id = shmget(IPC_PRIVATE, sizeof(ForkServerInput) + max_length,
+        IPC_CREAT | IPC_EXCL | 0600);
+    if (fs->shm_id < 0)
+    {
+        fprintf(stderr, "Could not create the shared memory for the input\n");
+        return -1;
+    }
+    void* shm = shmat(fs->shm_id, NULL, 0);
+    if (shm == (void*) -1)
+    {
+        fprintf(stderr, "Could not attach the shared memory for the input\n");
+        goto fail;
+    }
+    fs->input = shm;
+
+    int control[2], status[2];
+    if (pipe(control) != 0)
+        goto fail;
+    if (pipe(status) != 0)
+    {
+        close(control[0]);
+        close(control[1]);
+        goto fail;
+    }
+    signal(SIGPIPE, SIG_IGN);
+
+    fs->pid = fork();
+    if (fs->pid == 0)
+    {
+        char id[32];
+        snprintf(id, sizeof(id), "%d", fs->shm_id);
+        close(control[1]);
+        close(status[0]);
+        if (move_fd(control[0], FORKSERVER_CONTROL_FD) != 0
+            || move_fd(status[1], FORKSERVER_STATUS_FD) != 0
+            || setenv(FORKSERVER_SHM_ENV, id, 1) != 0)
+            _exit(127);
+        execv(argv[0], argv);
+        _exit(127);
+    }
+    close(control[0]);
+    close(status[1]);
+    fs->control_fd = control[1];
+    fs->status_fd = status[0];
+    if (fs->pid < 0)
+        goto fail;
+
+    // Later children of this process should not hold the pipes open.
+    fcntl(fs->control_fd, F_SETFD, FD_CLOEXEC);
+    fcntl(fs->status_fd, F_SETFD, FD_CLOEXEC);
+
+    int32_t hello;
+    if (read_reply(fs, &hello, timeout_ms) != 0 || hello != FORKSERVER_HELLO)
+    {
+        fprintf(stderr, "%s did not start a fork server\n", argv[0]);
+        goto fail;
+    }
+    return 0;
+
+fail:
+    breakdown_fork_server(fs);
+    return -1;
+}
+
+void breakdown_fork_server(ForkServer* fs)
+{
+    if (fs->control_fd >= 0)
+        close(fs->control_fd);
+    if (fs->status_fd >= 0)
+        close(fs->status_fd);
+    if (fs->pid > 0)
+    {
+        kill(fs->pid, SIGKILL);
+        waitpid(fs->pid, NULL, 0);
+    }
+    if (fs->input != NULL)
+        shmdt(fs->input);
+    if (fs->shm_id >= 0)
+        shmctl(fs->shm_id, IPC_RMID, NULL);
+    memset(fs, 0, sizeof(ForkServer));
+    fs->pid = -1;
+    fs->control_fd = -1;
+    fs->status_fd = -1;
+    fs->shm_id = -1;
+}
+
+int run_fork_server(ForkServer* fs, const uint8_t* data, size_t size,
+    unsigned timeout_ms, int* status)
+{
+    // The child is only started once the input is in place.
+    if (size > fs->max_length)
+        size = fs->max_length;
+    memcpy(fs->input->bytes, data, size);
+    fs->input->length = size;
+
+    int32_t child, reply = 0;
+    if (write(fs->control_fd, &reply, sizeof(reply)) != sizeof(reply)
+        || read_reply(fs, &child, 0) != 0)
+        goto died;
+
+    int ret = read_reply(fs, &reply, timeout_ms);
+    if (ret == 1)
+    {
+        // The fork server still replies with the wait status of the kill.
+        kill(child, SIGKILL);
+        if (read_reply(fs, &reply, 0) != 0)
+            goto died;
+    }
+    else if (ret != 0)
+        goto died;
+
+    *status = reply;
+    fs->execs++;
+    return ret;
+
+died:
+    fprintf(stderr, "The fork server has died\n");
+    return -1;
+}
@@ -0,0 +1,48 @@
+#include "../../include/fuzzer/forkserver.h"
+
+#include <stdlib.h>
+#include <sys/shm.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+// This file is linked into the target rather than the fuzzer.
+
+static int write_reply(int32_t value)
+{
+    return write(FORKSERVER_STATUS_FD, &value, sizeof(value)) == sizeof(value) ? 0 : -1;
+}
+
+int forkserver_start(const uint8_t** data, size_t* size)
+{
+    const char* id = getenv(FORKSERVER_SHM_ENV);
+    if (id == NULL)
+        return -1;
+    const ForkServerInput* input = shmat(atoi(id), NULL, SHM_RDONLY);
+    if (input == (void*) -1 || write_reply(FORKSERVER_HELLO) != 0)
+        return -1;
+
+    // The fuzzer closes the control pipe when it is done, which ends the loop.
+    for (;;)
+    {
+        int32_t command;
+        if (read(FORKSERVER_CONTROL_FD, &command, sizeof(command)) != sizeof(command))
+            _exit(0);
+
+        pid_t child = fork();
+        if (child < 0)
+            _exit(1);
+        if (child == 0)
+        {
+            close(FORKSERVER_CONTROL_FD);
+            close(FORKSERVER_STATUS_FD);
+            *data = input->bytes;
+            *size = input->length;
+            return 0;
+        }
+
+        int status;
+        if (write_reply(child) != 0 || waitpid(child, &status, 0) < 0
+            || write_reply(status) != 0)
+            _exit(1);
+    }
+}
@@ -1,48 +1,303 @@
 #include "../../include/grammar.h"
 #include "../../include/fuzzer/fuzzer.h"
 
-int is_non_terminal(Token key) 
+#include <string.h>
+
+// The number of frames allocated for a new Fuzzer's stack.
+#define INITIAL_STACK_CAPACITY 64
+
+int init_fuzzer(Fuzzer* fuzzer, const Grammar* grammar, uint64_t seed)
+{
+    memset(fuzzer, 0, sizeof(Fuzzer));
+    fuzzer->grammar = grammar;
+    rng_seed(&fuzzer->rng, seed);
+    fuzzer->stack = malloc(INITIAL_STACK_CAPACITY * sizeof(FuzzerFrame));
+    if (fuzzer->stack == NULL)
+        return -1;
+    fuzzer->capacity = INITIAL_STACK_CAPACITY;
+    return 0;
+}
+
+void breakdown_fuzzer(Fuzzer* fuzzer)
 {
-    if ((key & 0x80) == 0x80) {
-        return key & 0x0F;
+    free(fuzzer->stack);
+    memset(fuzzer, 0, sizeof(Fuzzer));
+}
+
+static int push_frame(Fuzzer* fuzzer, const Token* begin, const Token* end,
+    uint32_t node)
+{
+    if (fuzzer->depth == fuzzer->capacity)
+    {
+        size_t capacity = fuzzer->capacity ? fuzzer->capacity * 2 : INITIAL_STACK_CAPACITY;
+        FuzzerFrame* stack = realloc(fuzzer->stack, capacity * sizeof(FuzzerFrame));
+        if (stack == NULL)
+            return -1;
+        fuzzer->stack = stack;
+        fuzzer->capacity = capacity;
     }
-    return -1;
+    fuzzer->stack[fuzzer->depth++] = (FuzzerFrame) {begin, end, node, DERIVATION_NONE};
+    return 0;
+}
+
+void fuzzer_set_weights(Fuzzer* fuzzer, const RuleWeights* weights)
+{
+    fuzzer->weights = weights;
+}
+
+void fuzzer_set_coverage(Fuzzer* fuzzer, RuleCoverage* coverage)
+{
+    fuzzer->coverage = coverage;
+}
+
+void fuzzer_set_derivation(Fuzzer* fuzzer, DerivationTree* tree)
+{
+    fuzzer->derivation = tree;
+}
+
+void fuzzer_set_budget(Fuzzer* fuzzer, const MinCostTable* costs,
+    size_t budget)
+{
+    fuzzer->costs = costs;
+    fuzzer->budget = budget;
+}
+
+// Starts the budget of a new string whose cheapest completion costs `cost`.
+static int start_budget(Fuzzer* fuzzer, size_t cost)
+{
+    if (cost == COST_INF)
+        return -1;
+    fuzzer->slack = fuzzer->budget > cost ? fuzzer->budget - cost : 0;
+    return 0;
+}
+
+// Picks the global index of the rule to expand non-terminal `nt_index` with.
+static size_t choose_rule(Fuzzer* fuzzer, size_t nt_index)
+{
+    const Grammar* grammar = fuzzer->grammar;
+    const MinCostTable* costs = fuzzer->costs;
+
+    if (costs != NULL && fuzzer->slack == 0)
+        return costs->cheapest_rule[nt_index];
+
+    size_t rule_index = fuzzer->weights != NULL
+        ? choose_weighted_rule(fuzzer->weights, nt_index, &fuzzer->rng)
+        : grammar_first_rule(grammar, nt_index)
+            + rng_bounded(&fuzzer->rng, grammar_num_rules(grammar, nt_index));
+    if (costs == NULL)
+        return rule_index;
+
+    // The string may cost `slack` more than its cheapest completion. Using
+    // this rule instead of the cheapest one takes up `extra` of that.
+    size_t extra = costs->rule_min[rule_index] - costs->key_min[nt_index];
+    if (costs->rule_min[rule_index] == COST_INF || extra > fuzzer->slack)
+        return costs->cheapest_rule[nt_index];
+    fuzzer->slack -= extra;
+    return rule_index;
+}
+
+// Adds the node of `key`, expanded with `rule_index`, as the next child of
+// the frame `top`. Terminals only get a node when they are the root.
+static uint32_t record_node(DerivationTree* tree, FuzzerFrame* top, Token key,
+    uint32_t rule_index)
+{
+    uint32_t node = add_derivation_node(tree, top->node, top->last_child, key,
+        rule_index, tree->num_tokens);
+    top->last_child = node;
+    return node;
 }
 
-void unify_key_inv(Token key, Grammar* grammar, TokenArray* fuzzed)
+// Expands the frames on the stack until it is empty, adding the derivation
+// to `tree` unless it is NULL. On failure, the new nodes are left unfinished
+// in the tree. Tokens are visited in the same
+// order as a recursive depth-first expansion, so random numbers are drawn in
+// the same order too.
+static int run_fuzzer(Fuzzer* fuzzer, TokenArray* fuzzed, DerivationTree* tree)
 {
-    size_t nt_index;
-    if ((nt_index = is_non_terminal(key)) != -1)
+    const Grammar* grammar = fuzzer->grammar;
+
+    while (fuzzer->depth > 0)
     {
-        size_t rand_index = rand() % grammar->non_terminals[nt_index].num_rules;
-        unify_rule_inv(
-            grammar->non_terminals[nt_index].rules[rand_index],
-            grammar,
-            fuzzed
-        );
+        // A popped frame is still valid until the next push.
+        FuzzerFrame* top = &fuzzer->stack[fuzzer->depth - 1];
+        Token key = *top->next++;
+        if (top->next == top->end)
+            fuzzer->depth--;
+
+        int nt_index;
+        if ((nt_index = is_non_terminal(key)) != -1)
+        {
+            size_t rule_index = choose_rule(fuzzer, nt_index);
+            if (fuzzer->coverage != NULL)
+                record_rule_hit(fuzzer->coverage, rule_index);
+            uint32_t node = DERIVATION_NONE;
+            if (tree != NULL
+                && (node = record_node(tree, top, key, rule_index)) == DERIVATION_NONE)
+                goto fail;
+            Rule rule = grammar_rule(grammar, rule_index);
+            if (rule.num_tokens > 0
+                && push_frame(fuzzer, rule.tokens, rule.tokens + rule.num_tokens, node) != 0)
+                goto fail;
+        }
+        else
+        {
+            // The only string which a terminal symbol can generate is
+            // the symbol itself. Its token counts towards the node of the
+            // rule it belongs to.
+            if (token_array_push(fuzzed, key) != 0)
+                goto fail;
+            if (tree != NULL)
+            {
+                if (tree->num_tokens == UINT32_MAX)
+                    goto fail;
+                if (top->node != DERIVATION_NONE)
+                    tree->nodes[top->node].token_len++;
+                else if (record_node(tree, top, key, DERIVATION_NONE) != DERIVATION_NONE)
+                    tree->nodes[tree->root].token_len = 1;
+                else
+                    goto fail;
+                tree->num_tokens++;
+            }
+        }
     }
+
+    return flush_token_array(fuzzed);
+
+fail:
+    fuzzer->depth = 0;
+    return -1;
+}
+
+int unify_key_inv(Token key, Fuzzer* fuzzer, TokenArray* fuzzed)
+{
+    // `key` stays in scope until the stack has been emptied.
+    fuzzer->depth = 0;
+    if (fuzzer->derivation != NULL)
+        clear_derivation_tree(fuzzer->derivation);
+    if (fuzzer->costs != NULL
+        && start_budget(fuzzer, key_min_cost(fuzzer->costs, key)) != 0)
+        return -1;
+    if (push_frame(fuzzer, &key, &key + 1, DERIVATION_NONE) != 0)
+        return -1;
+
+    DerivationTree* tree = fuzzer->derivation;
+    int ret = run_fuzzer(fuzzer, fuzzed, tree);
+    if (tree != NULL && ret != 0)
+        clear_derivation_tree(tree);
+    else if (tree != NULL)
+        finish_derivation_tree(tree, 0);
+    return ret;
+}
+
+uint32_t derive_subtree(Token key, Fuzzer* fuzzer, DerivationTree* tree,
+    TokenArray* fuzzed)
+{
+    // The new nodes are added as if they were a tree of their own, with
+    // spans starting at 0, then the tree's own root and length are put back.
+    uint32_t root = tree->root;
+    uint32_t num_tokens = tree->num_tokens;
+    uint32_t first_node = tree->num_nodes;
+    tree->num_tokens = 0;
+
+    fuzzer->depth = 0;
+    int ret = -1;
+    if ((fuzzer->costs == NULL
+            || start_budget(fuzzer, key_min_cost(fuzzer->costs, key)) == 0)
+        && push_frame(fuzzer, &key, &key + 1, DERIVATION_NONE) == 0)
+        ret = run_fuzzer(fuzzer, fuzzed, tree);
+
+    uint32_t subtree = first_node;
+    if (ret == 0)
+        finish_derivation_tree(tree, first_node);
     else
     {
-        // The only string which a terminal symbol can generate is 
-        // the symbol itself.
-        fuzzed->tokens[fuzzed->index] = key;
-        fuzzed->index++;
+        tree->num_nodes = first_node;
+        subtree = DERIVATION_NONE;
     }
+    tree->root = root;
+    tree->num_tokens = num_tokens;
+    return subtree;
 }
 
-void unify_rule_inv(Rule rule, Grammar* grammar, TokenArray* fuzzed)
+int unify_rule_inv(Rule rule, Fuzzer* fuzzer, TokenArray* fuzzed)
 {
-    for (size_t i = 0; i < rule.num_tokens; i++)
+    fuzzer->depth = 0;
+    if (fuzzer->derivation != NULL)
+        clear_derivation_tree(fuzzer->derivation);
+    if (fuzzer->costs != NULL)
     {
-        unify_key_inv(rule.tokens[i], grammar, fuzzed);
+        size_t cost = 0;
+        for (size_t i = 0; i < rule.num_tokens && cost != COST_INF; i++)
+        {
+            size_t token_cost = key_min_cost(fuzzer->costs, rule.tokens[i]);
+            cost = token_cost > COST_INF - cost ? COST_INF : cost + token_cost;
+        }
+        if (start_budget(fuzzer, cost) != 0)
+            return -1;
     }
+    if (rule.num_tokens == 0)
+        return 0;
+    if (push_frame(fuzzer, rule.tokens, rule.tokens + rule.num_tokens,
+        DERIVATION_NONE) != 0)
+        return -1;
+    return run_fuzzer(fuzzer, fuzzed, NULL);
 }
 
-void print_token_array(TokenArray* fuzzed) 
+int init_fuzz_batch(FuzzBatch* batch, size_t num_strings, size_t num_tokens)
+{
+    memset(batch, 0, sizeof(FuzzBatch));
+    batch->offsets = malloc((num_strings + 1) * sizeof(size_t));
+    if (batch->offsets == NULL || init_token_array(&batch->tokens, num_tokens) != 0)
+    {
+        free(batch->offsets);
+        batch->offsets = NULL;
+        return -1;
+    }
+    batch->offsets[0] = 0;
+    batch->capacity = num_strings;
+    return 0;
+}
+
+void breakdown_fuzz_batch(FuzzBatch* batch)
+{
+    breakdown_token_array(&batch->tokens);
+    free(batch->offsets);
+    memset(batch, 0, sizeof(FuzzBatch));
+}
+
+int fuzz_batch(Token key, size_t num_strings, Fuzzer* fuzzer, FuzzBatch* batch)
+{
+    clear_token_array(&batch->tokens);
+    batch->num_strings = 0;
+
+    if (num_strings > batch->capacity)
+    {
+        size_t* offsets = realloc(batch->offsets, (num_strings + 1) * sizeof(size_t));
+        if (offsets == NULL)
+            return -1;
+        batch->offsets = offsets;
+        batch->capacity = num_strings;
+    }
+
+    // Each string is appended to the arena directly after the previous one.
+    for (size_t i = 0; i < num_strings; i++)
+    {
+        if (unify_key_inv(key, fuzzer, &batch->tokens) != 0)
+        {
+            batch->tokens.index = batch->offsets[batch->num_strings];
+            return -1;
+        }
+        batch->offsets[++batch->num_strings] = batch->tokens.index;
+    }
+
+    return 0;
+}
+
+void print_token_array(TokenArray* fuzzed)
 {
     for (size_t i = 0; i < fuzzed->index; i++)
     {
         printf("0x%x ", fuzzed->tokens[i]);
     }
     printf("\n");
-}
\ No newline at end of file
+}
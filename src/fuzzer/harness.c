@@ -0,0 +1,305 @@
+#include "../../include/fuzzer/harness.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <signal.h>
+#include <string.h>
+#include <sys/time.h>
+#include <sys/wait.h>
+#include <time.h>
+#include <unistd.h>
+
+// The number of bytes a ByteArray allocates when it first needs space.
+#define BYTE_ARRAY_INITIAL_CAPACITY 256
+
+// The signals which end the process when the target crashes.
+static const int FATAL_SIGNALS[] = {SIGSEGV, SIGBUS, SIGFPE, SIGILL, SIGABRT};
+#define NUM_FATAL_SIGNALS (sizeof(FATAL_SIGNALS) / sizeof(FATAL_SIGNALS[0]))
+
+// The Harness being run, and when its current input started in nanoseconds
+// (0 between inputs). Both are read by the signal handlers.
+static Harness* volatile active_harness;
+static volatile uint64_t exec_start_ns;
+
+static uint64_t now_ns(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t) ts.tv_sec * 1000000000 + ts.tv_nsec;
+}
+
+static int reserve_bytes(ByteArray* arr, size_t length)
+{
+    if (length <= arr->capacity)
+        return 0;
+    size_t capacity = arr->capacity ? arr->capacity : BYTE_ARRAY_INITIAL_CAPACITY;
+    while (capacity < length)
+        capacity *= 2;
+    uint8_t* bytes = realloc(arr->bytes, capacity);
+    if (bytes == NULL)
+        return -1;
+    arr->bytes = bytes;
+    arr->capacity = capacity;
+    return 0;
+}
+
+int detokenise(const GrammarFile* gf, const Token* tokens, size_t num_tokens,
+    ByteArray* out)
+{
+    for (size_t i = 0; i < num_tokens; i++)
+    {
+        Token key = tokens[i];
+        if (key >= gf->num_terminals)
+            return -1;
+        size_t length = gf->terminal_lengths[key];
+        if (reserve_bytes(out, out->length + length) != 0)
+            return -1;
+        memcpy(out->bytes + out->length, gf->strings + gf->terminal_strs[key], length);
+        out->length += length;
+    }
+    return 0;
+}
+
+int init_harness(Harness* h, const GrammarFile* gf, Fuzzer* fuzzer,
+    FuzzTarget target, const char* crash_dir)
+{
+    memset(h, 0, sizeof(Harness));
+    h->gf = gf;
+    h->fuzzer = fuzzer;
+    h->target = target;
+    h->crash_dir = crash_dir;
+
+    // The target is never passed a NULL pointer, even for an empty input.
+    if (init_token_array(&h->tokens, 0) != 0
+        || reserve_bytes(&h->input, BYTE_ARRAY_INITIAL_CAPACITY) != 0)
+    {
+        breakdown_harness(h);
+        return -1;
+    }
+    return 0;
+}
+
+void breakdown_harness(Harness* h)
+{
+    breakdown_token_array(&h->tokens);
+    free(h->input.bytes);
+    memset(h, 0, sizeof(Harness));
+}
+
+// The helpers below only call functions which are safe in a signal handler.
+
+static void append_str(char* buf, size_t size, size_t* len, const char* str)
+{
+    while (*str != '\0' && *len + 1 < size)
+        buf[(*len)++] = *str++;
+    buf[*len] = '\0';
+}
+
+static void write_str(const char* str)
+{
+    ssize_t ret = write(STDERR_FILENO, str, strlen(str));
+    (void) ret;
+}
+
+// Saves the current input as `crash_dir`/`prefix`-<hash of the input>. An
+// input which has already been saved is not written again.
+static void save_input(const Harness* h, const char* prefix)
+{
+    if (h->crash_dir == NULL)
+        return;
+
+    uint64_t hash = 14695981039346656037ULL;
+    for (size_t i = 0; i < h->input.length; i++)
+    {
+        hash = (hash ^ h->input.bytes[i]) * 1099511628211ULL;
+    }
+    char digits[17];
+    for (int i = 15; i >= 0; i--, hash >>= 4)
+    {
+        digits[i] = "0123456789abcdef"[hash & 0xf];
+    }
+    digits[16] = '\0';
+
+    char path[4096];
+    size_t len = 0;
+    append_str(path, sizeof(path), &len, h->crash_dir);
+    append_str(path, sizeof(path), &len, "/");
+    append_str(path, sizeof(path), &len, prefix);
+    append_str(path, sizeof(path), &len, "-");
+    append_str(path, sizeof(path), &len, digits);
+
+    int fd = open(path, O_WRONLY | O_CREAT | O_EXCL, 0644);
+    if (fd < 0)
+    {
+        if (errno != EEXIST)
+            write_str("Could not save the input to the crash directory\n");
+        return;
+    }
+    for (size_t done = 0; done < h->input.length;)
+    {
+        ssize_t ret = write(fd, h->input.bytes + done, h->input.length - done);
+        if (ret <= 0)
+            break;
+        done += ret;
+    }
+    close(fd);
+
+    write_str("Saved ");
+    write_str(path);
+    write_str("\n");
+}
+
+static void on_fatal_signal(int sig)
+{
+    Harness* h = active_harness;
+    if (h != NULL && exec_start_ns != 0)
+    {
+        write_str("The target crashed\n");
+        save_input(h, "crash");
+    }
+
+    // The handler was reset on entry, so this ends the process.
+    raise(sig);
+}
+
+static void on_watchdog(int sig)
+{
+    (void) sig;
+    Harness* h = active_harness;
+    uint64_t start = exec_start_ns;
+    if (h == NULL || start == 0
+        || now_ns() - start < (uint64_t) h->timeout_ms * 1000000)
+        return;
+
+    write_str("The target hung\n");
+    save_input(h, "timeout");
+    _exit(HARNESS_TIMEOUT_EXIT);
+}
+
+// Sets the watchdog to check the running input every half timeout.
+static int set_watchdog(unsigned timeout_ms)
+{
+    unsigned interval_ms = timeout_ms > 1 ? timeout_ms / 2 : timeout_ms;
+    struct itimerval timer = {
+        {interval_ms / 1000, (interval_ms % 1000) * 1000},
+        {interval_ms / 1000, (interval_ms % 1000) * 1000}
+    };
+    return setitimer(ITIMER_REAL, &timer, NULL);
+}
+
+// Runs the current input in a child of the fork server, cutting it to the
+// length the server accepts so the input saved is the one which was run.
+static int run_child(Harness* h, int* failed, int* timed_out)
+{
+    if (h->input.length > h->server->max_length)
+        h->input.length = h->server->max_length;
+
+    int status;
+    int ret = run_fork_server(h->server, h->input.bytes, h->input.length,
+        h->timeout_ms, &status);
+    if (ret < 0)
+        return -1;
+    *timed_out = ret == 1;
+    *failed = !*timed_out && (WIFSIGNALED(status) || WEXITSTATUS(status) != 0);
+    return 0;
+}
+
+static void report(const Harness* h, size_t execs, double seconds)
+{
+    fprintf(stderr, "#%zu\t%.0f execs/s\t%zu crashes\t%zu timeouts\n",
+        h->execs, seconds > 0 ? execs / seconds : 0.0, h->crashes, h->timeouts);
+}
+
+int run_harness(Harness* h, Token key, size_t num_execs)
+{
+    struct sigaction action, old_fatal[NUM_FATAL_SIGNALS], old_alarm;
+    memset(&action, 0, sizeof(action));
+    sigemptyset(&action.sa_mask);
+    action.sa_handler = on_fatal_signal;
+    action.sa_flags = SA_RESETHAND | SA_NODEFER;
+    for (size_t i = 0; i < NUM_FATAL_SIGNALS; i++)
+    {
+        sigaction(FATAL_SIGNALS[i], &action, &old_fatal[i]);
+    }
+    action.sa_handler = on_watchdog;
+    action.sa_flags = SA_RESTART;
+    sigaction(SIGALRM, &action, &old_alarm);
+
+    // A fork server times its children itself.
+    int watchdog = h->timeout_ms != 0 && h->server == NULL;
+    active_harness = h;
+    int ret = 0;
+    if (watchdog && set_watchdog(h->timeout_ms) != 0)
+        ret = -1;
+
+    uint64_t timeout_ns = (uint64_t) h->timeout_ms * 1000000;
+    uint64_t report_ns = h->report_interval * 1e9;
+    uint64_t run_start = now_ns();
+    uint64_t last_report = run_start;
+    size_t first_exec = h->execs;
+
+    for (size_t i = 0; ret == 0 && (num_execs == 0 || i < num_execs); i++)
+    {
+        clear_token_array(&h->tokens);
+        h->input.length = 0;
+        if (unify_key_inv(key, h->fuzzer, &h->tokens) != 0
+            || detokenise(h->gf, h->tokens.tokens, h->tokens.index, &h->input) != 0)
+        {
+            ret = -1;
+            break;
+        }
+
+        int failed, timed_out;
+        uint64_t start = now_ns(), end;
+        if (h->server != NULL)
+        {
+            if (run_child(h, &failed, &timed_out) != 0)
+            {
+                ret = -1;
+                break;
+            }
+            end = now_ns();
+        }
+        else
+        {
+            exec_start_ns = start;
+            failed = h->target(h->input.bytes, h->input.length) != 0;
+            end = now_ns();
+            exec_start_ns = 0;
+            timed_out = timeout_ns != 0 && end - start > timeout_ns;
+        }
+        h->execs++;
+
+        if (failed)
+        {
+            h->crashes++;
+            save_input(h, "crash");
+        }
+        else if (timed_out)
+        {
+            h->timeouts++;
+            save_input(h, "timeout");
+        }
+
+        if (report_ns != 0 && end - last_report >= report_ns)
+        {
+            report(h, h->execs - first_exec, (end - run_start) / 1e9);
+            last_report = end;
+        }
+    }
+
+    double seconds = (now_ns() - run_start) / 1e9;
+    h->seconds += seconds;
+    if (h->report_interval > 0)
+        report(h, h->execs - first_exec, seconds);
+
+    if (watchdog)
+        set_watchdog(0);
+    active_harness = NULL;
+    sigaction(SIGALRM, &old_alarm, NULL);
+    for (size_t i = 0; i < NUM_FATAL_SIGNALS; i++)
+    {
+        sigaction(FATAL_SIGNALS[i], &old_fatal[i], NULL);
+    }
+    return ret;
+}
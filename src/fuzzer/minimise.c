@@ -0,0 +1,415 @@
+#include "../../include/fuzzer/minimise.h"
+
+#include <string.h>
+
+// The reserved all-ones token, which no node of a tree has as its symbol.
+#define NO_NON_TERMINAL ((Token) ~(Token) 0)
+
+int init_minimiser(Minimiser* m, const Grammar* grammar,
+    MinimisePredicate predicate, void* ctx)
+{
+    memset(m, 0, sizeof(Minimiser));
+    m->grammar = grammar;
+    m->predicate = predicate;
+    m->ctx = ctx;
+
+    // A Fuzzer with nothing to spend only follows the cheapest rules, so it
+    // derives the smallest subtree without drawing any random numbers.
+    if (init_min_cost_table(&m->costs, grammar, NULL, 0) != 0
+        || init_fuzzer(&m->smallest, grammar, 0) != 0
+        || init_derivation_tree(&m->tree, grammar, 0) != 0
+        || init_derivation_tree(&m->candidate, grammar, 0) != 0
+        || init_token_array(&m->tokens, 0) != 0
+        || init_token_array(&m->scratch, 0) != 0)
+    {
+        breakdown_minimiser(m);
+        return -1;
+    }
+    fuzzer_set_budget(&m->smallest, &m->costs, 0);
+    return 0;
+}
+
+void breakdown_minimiser(Minimiser* m)
+{
+    breakdown_min_cost_table(&m->costs);
+    breakdown_fuzzer(&m->smallest);
+    breakdown_derivation_tree(&m->tree);
+    breakdown_derivation_tree(&m->candidate);
+    breakdown_token_array(&m->tokens);
+    breakdown_token_array(&m->scratch);
+    free(m->depth);
+    free(m->level);
+    free(m->config);
+    free(m->subset);
+    free(m->kept);
+    memset(m, 0, sizeof(Minimiser));
+}
+
+// Makes each scratch array big enough for every node of `m->tree`.
+static int reserve_scratch(Minimiser* m)
+{
+    size_t n = m->tree.num_nodes;
+    if (n <= m->scratch_capacity)
+        return 0;
+
+    uint32_t** arrays[] = {&m->depth, &m->level, &m->config, &m->subset};
+    for (size_t i = 0; i < sizeof(arrays) / sizeof(arrays[0]); i++)
+    {
+        uint32_t* array = realloc(*arrays[i], n * sizeof(uint32_t));
+        if (array == NULL)
+            return -1;
+        *arrays[i] = array;
+    }
+    uint8_t* kept = realloc(m->kept, n);
+    if (kept == NULL)
+        return -1;
+    m->kept = kept;
+    m->scratch_capacity = n;
+    return 0;
+}
+
+// Tests the candidate, unless it is no shorter than the current string.
+static int test_candidate(Minimiser* m)
+{
+    clear_token_array(&m->scratch);
+    if (derivation_tree_string(&m->candidate, &m->scratch) != 0)
+        return -1;
+    if (m->scratch.index >= m->tokens.index)
+        return 0;
+    m->num_tests++;
+    return m->predicate(m->scratch.tokens, m->scratch.index, m->ctx) != 0;
+}
+
+// Makes the candidate the current derivation.
+static int accept_candidate(Minimiser* m)
+{
+    clear_token_array(&m->tokens);
+    if (compact_derivation_tree(&m->tree, &m->candidate) != 0
+        || derivation_tree_string(&m->tree, &m->tokens) != 0)
+        return -1;
+    return 0;
+}
+
+// Expands node `node` of the candidate with the smallest derivation of its
+// non-terminal.
+static int replace_with_smallest(Minimiser* m, uint32_t node)
+{
+    DerivationTree* cand = &m->candidate;
+    uint32_t subtree = derive_subtree(cand->nodes[node].symbol, &m->smallest,
+        cand, &m->scratch);
+    if (subtree == DERIVATION_NONE)
+        return -1;
+    cand->nodes[node].rule = cand->nodes[subtree].rule;
+    cand->nodes[node].first_child = cand->nodes[subtree].first_child;
+    return 0;
+}
+
+// Whether the subtree of `node` is longer than the smallest derivation of
+// its non-terminal.
+static int is_reducible(const Minimiser* m, uint32_t node)
+{
+    const DerivationNode* n = &m->tree.nodes[node];
+    return n->rule != DERIVATION_NONE
+        && n->token_len > key_min_cost(&m->costs, n->symbol);
+}
+
+// Collects the reducible nodes at depth `depth` of the current tree into
+// `m->level`, returning how many there are. `exists` is set to whether the
+// tree has any nodes at that depth.
+static int collect_level(Minimiser* m, uint32_t depth, size_t* num_nodes,
+    int* exists)
+{
+    if (reserve_scratch(m) != 0)
+        return -1;
+
+    // The tree is compact, so every parent comes before its children.
+    const DerivationTree* tree = &m->tree;
+    m->depth[tree->root] = 0;
+    *num_nodes = 0;
+    *exists = 0;
+    for (uint32_t i = 0; i < tree->num_nodes; i++)
+    {
+        for (uint32_t c = tree->nodes[i].first_child; c != DERIVATION_NONE;
+            c = tree->nodes[c].next_sibling)
+        {
+            m->depth[c] = m->depth[i] + 1;
+        }
+        if (m->depth[i] == depth)
+        {
+            *exists = 1;
+            if (is_reducible(m, i))
+                m->level[(*num_nodes)++] = i;
+        }
+    }
+    return 0;
+}
+
+// Builds the candidate in which every node of the level, other than the
+// `num_kept` positions in `kept`, has its smallest derivation.
+static int build_level_candidate(Minimiser* m, size_t num_nodes,
+    const uint32_t* kept, size_t num_kept)
+{
+    memset(m->kept, 0, num_nodes);
+    for (size_t i = 0; i < num_kept; i++)
+    {
+        m->kept[kept[i]] = 1;
+    }
+
+    if (copy_derivation_tree(&m->candidate, &m->tree) != 0)
+        return -1;
+    for (size_t i = 0; i < num_nodes; i++)
+    {
+        if (!m->kept[i] && replace_with_smallest(m, m->level[i]) != 0)
+            return -1;
+    }
+    return 0;
+}
+
+// Finds a small set of the level's nodes to keep, replacing the rest with
+// their smallest derivations, by delta debugging. Returns `1` if the tree
+// has changed, `0` if not, otherwise `-1`.
+static int reduce_level(Minimiser* m, size_t num_nodes)
+{
+    int ret;
+    if (build_level_candidate(m, num_nodes, NULL, 0) != 0
+        || (ret = test_candidate(m)) < 0)
+        return -1;
+    if (ret == 1)
+        return accept_candidate(m) != 0 ? -1 : 1;
+
+    // `config` holds the positions kept by the last candidate which passed.
+    size_t size = num_nodes;
+    for (size_t i = 0; i < size; i++)
+    {
+        m->config[i] = i;
+    }
+
+    // Split the kept nodes into `n` chunks. Try keeping just one chunk, then
+    // all but one, and split more finely when neither shrinks the string.
+    size_t n = 2;
+    while (size >= 2)
+    {
+        int found = 0;
+        for (int complement = 0; complement < 2 && !found; complement++)
+        {
+            if (complement && n == 2)
+                break;
+            for (size_t i = 0; i < n && !found; i++)
+            {
+                size_t begin = size * i / n;
+                size_t end = size * (i + 1) / n;
+                size_t num_kept = 0;
+                for (size_t j = 0; j < size; j++)
+                {
+                    if ((j >= begin && j < end) != complement)
+                        m->subset[num_kept++] = m->config[j];
+                }
+
+                if (build_level_candidate(m, num_nodes, m->subset, num_kept) != 0
+                    || (ret = test_candidate(m)) < 0)
+                    return -1;
+                if (ret == 1)
+                {
+                    memcpy(m->config, m->subset, num_kept * sizeof(uint32_t));
+                    size = num_kept;
+                    n = complement && n > 2 ? n - 1 : 2;
+                    found = 1;
+                }
+            }
+        }
+
+        if (!found)
+        {
+            if (n >= size)
+                break;
+            n = 2 * n < size ? 2 * n : size;
+        }
+    }
+
+    if (size == num_nodes)
+        return 0;
+    if (build_level_candidate(m, num_nodes, m->config, size) != 0
+        || accept_candidate(m) != 0)
+        return -1;
+    return 1;
+}
+
+// Tries replacing the subtree of `node` with a subtree of the same
+// non-terminal nested inside it.
+static int try_hoisting(Minimiser* m, uint32_t node)
+{
+    const DerivationTree* tree = &m->tree;
+    uint32_t end = derivation_subtree_end(tree, node);
+    for (uint32_t d = node + 1; d < end; d++)
+    {
+        if (tree->nodes[d].symbol != tree->nodes[node].symbol)
+            continue;
+
+        if (copy_derivation_tree(&m->candidate, tree) != 0)
+            return -1;
+        m->candidate.nodes[node].rule = tree->nodes[d].rule;
+        m->candidate.nodes[node].first_child = tree->nodes[d].first_child;
+        int ret = test_candidate(m);
+        if (ret != 0)
+            return ret < 0 || accept_candidate(m) != 0 ? -1 : 1;
+    }
+    return 0;
+}
+
+// Builds the candidate in which `node` is expanded with rule `rule_index`.
+// Each non-terminal of the rule takes the next child of the same
+// non-terminal, if there is one, otherwise its smallest derivation. The
+// search for children starts at child `start` of `node`.
+static int build_rule_candidate(Minimiser* m, uint32_t node, uint32_t rule_index,
+    uint32_t start)
+{
+    DerivationTree* cand = &m->candidate;
+    if (copy_derivation_tree(cand, &m->tree) != 0)
+        return -1;
+
+    Rule rule = grammar_rule(m->grammar, rule_index);
+    uint32_t child = start;
+    uint32_t first = DERIVATION_NONE, prev = DERIVATION_NONE;
+    for (size_t i = 0; i < rule.num_tokens; i++)
+    {
+        Token key = rule.tokens[i];
+        if (is_non_terminal(key) == -1)
+            continue;
+
+        uint32_t next = child;
+        while (next != DERIVATION_NONE && cand->nodes[next].symbol != key)
+            next = cand->nodes[next].next_sibling;
+        if (next != DERIVATION_NONE)
+            child = cand->nodes[next].next_sibling;
+        else if ((next = derive_subtree(key, &m->smallest, cand, &m->scratch)) == DERIVATION_NONE)
+            return -1;
+
+        if (prev == DERIVATION_NONE)
+            first = next;
+        else
+            cand->nodes[prev].next_sibling = next;
+        prev = next;
+    }
+    if (prev != DERIVATION_NONE)
+        cand->nodes[prev].next_sibling = DERIVATION_NONE;
+
+    cand->nodes[node].rule = rule_index;
+    cand->nodes[node].first_child = first;
+    return 0;
+}
+
+// Returns the first non-terminal of a rule, or NO_NON_TERMINAL if it has none.
+static Token first_non_terminal(Rule rule)
+{
+    for (size_t i = 0; i < rule.num_tokens; i++)
+    {
+        if (is_non_terminal(rule.tokens[i]) != -1)
+            return rule.tokens[i];
+    }
+    return NO_NON_TERMINAL;
+}
+
+// Tries expanding `node` with each other rule of its non-terminal which
+// could make its subtree shorter. The first non-terminal of the rule is
+// given each child of the same non-terminal in turn, so that the one which
+// holds what the predicate needs is not passed over.
+static int try_rules(Minimiser* m, uint32_t node)
+{
+    const DerivationNode* n = &m->tree.nodes[node];
+    size_t nt_index = is_non_terminal(n->symbol);
+    size_t first_rule = grammar_first_rule(m->grammar, nt_index);
+    uint32_t current_rule = n->rule;
+    uint32_t len = n->token_len;
+
+    for (size_t r = first_rule; r < first_rule + grammar_num_rules(m->grammar, nt_index); r++)
+    {
+        if (r == current_rule || m->costs.rule_min[r] >= len)
+            continue;
+
+        // Without a matching child, the rule is built once from its
+        // smallest derivations.
+        Token key = first_non_terminal(grammar_rule(m->grammar, r));
+        int matched = 0;
+        for (uint32_t c = m->tree.nodes[node].first_child; ; c = m->tree.nodes[c].next_sibling)
+        {
+            if (c != DERIVATION_NONE && m->tree.nodes[c].symbol != key)
+                continue;
+            if (c == DERIVATION_NONE && matched)
+                break;
+            matched = 1;
+
+            int ret;
+            if (build_rule_candidate(m, node, r, c) != 0 || (ret = test_candidate(m)) < 0)
+                return -1;
+            if (ret == 1)
+                return accept_candidate(m) != 0 ? -1 : 1;
+            if (c == DERIVATION_NONE)
+                break;
+        }
+    }
+    return 0;
+}
+
+int minimise(Minimiser* m, const DerivationTree* tree)
+{
+    m->num_tests = 0;
+    clear_token_array(&m->tokens);
+    if (compact_derivation_tree(&m->tree, tree) != 0
+        || derivation_tree_string(&m->tree, &m->tokens) != 0)
+        return -1;
+
+    m->num_tests++;
+    if (!m->predicate(m->tokens.tokens, m->tokens.index, m->ctx))
+    {
+        fprintf(stderr, "The predicate does not hold for the string to minimise\n");
+        return -1;
+    }
+
+    // Work down the tree a level at a time, and start again from the root
+    // until a whole pass changes nothing.
+    int changed;
+    do
+    {
+        changed = 0;
+        int exists = 1;
+        for (uint32_t depth = 0; exists; depth++)
+        {
+            size_t num_nodes;
+            int ret;
+            if (collect_level(m, depth, &num_nodes, &exists) != 0)
+                return -1;
+            if (num_nodes == 0)
+                continue;
+            if ((ret = reduce_level(m, num_nodes)) < 0)
+                return -1;
+            if (ret == 1)
+            {
+                changed = 1;
+                if (collect_level(m, depth, &num_nodes, &exists) != 0)
+                    return -1;
+            }
+
+            // A change renumbers only the nodes after the changed one, so
+            // the nodes of the level before it need not be tried again.
+            size_t i = 0;
+            while (i < num_nodes)
+            {
+                uint32_t node = m->level[i];
+                if ((ret = try_hoisting(m, node)) == 0)
+                    ret = try_rules(m, node);
+                if (ret < 0)
+                    return -1;
+                if (ret == 0)
+                {
+                    i++;
+                    continue;
+                }
+                changed = 1;
+                if (collect_level(m, depth, &num_nodes, &exists) != 0)
+                    return -1;
+            }
+        }
+    } while (changed);
+
+    return 0;
+}
@@ -0,0 +1,301 @@
+#include "../../include/fuzzer/mutator.h"
+
+#include <string.h>
+
+// The number of entries or node references allocated when an empty corpus
+// or list first needs space.
+#define INITIAL_CAPACITY 16
+
+// The number of nodes MUTATE_RECURSE tries before giving up on a string.
+#define RECURSE_ATTEMPTS 8
+
+int init_corpus(Corpus* corpus, const Grammar* grammar)
+{
+    memset(corpus, 0, sizeof(Corpus));
+    corpus->grammar = grammar;
+    corpus->by_symbol = calloc(grammar->num_non_terminals + 1, sizeof(NodeRefList));
+    return corpus->by_symbol == NULL ? -1 : 0;
+}
+
+void breakdown_corpus(Corpus* corpus)
+{
+    for (size_t i = 0; i < corpus->num_entries; i++)
+    {
+        breakdown_derivation_tree(&corpus->entries[i].tree);
+        breakdown_token_array(&corpus->entries[i].tokens);
+    }
+    if (corpus->by_symbol != NULL)
+    {
+        for (size_t nt = 0; nt < corpus->grammar->num_non_terminals; nt++)
+        {
+            free(corpus->by_symbol[nt].refs);
+        }
+    }
+    free(corpus->entries);
+    free(corpus->by_symbol);
+    memset(corpus, 0, sizeof(Corpus));
+}
+
+static int push_node_ref(NodeRefList* list, NodeRef ref)
+{
+    if (list->count == list->capacity)
+    {
+        size_t capacity = list->capacity ? list->capacity * 2 : INITIAL_CAPACITY;
+        NodeRef* refs = realloc(list->refs, capacity * sizeof(NodeRef));
+        if (refs == NULL)
+            return -1;
+        list->refs = refs;
+        list->capacity = capacity;
+    }
+    list->refs[list->count++] = ref;
+    return 0;
+}
+
+int add_corpus_entry(Corpus* corpus, const DerivationTree* tree)
+{
+    if (tree->root == DERIVATION_NONE || corpus->num_entries >= UINT32_MAX)
+        return -1;
+    if (corpus->num_entries == corpus->capacity)
+    {
+        size_t capacity = corpus->capacity ? corpus->capacity * 2 : INITIAL_CAPACITY;
+        CorpusEntry* entries = realloc(corpus->entries, capacity * sizeof(CorpusEntry));
+        if (entries == NULL)
+            return -1;
+        corpus->entries = entries;
+        corpus->capacity = capacity;
+    }
+
+    // Serialising the compact copy sets spans which index into its string.
+    uint32_t index = corpus->num_entries;
+    CorpusEntry* entry = &corpus->entries[index];
+    if (init_derivation_tree(&entry->tree, corpus->grammar, tree->num_nodes) != 0
+        || init_token_array(&entry->tokens, tree->num_tokens) != 0
+        || compact_derivation_tree(&entry->tree, tree) != 0
+        || derivation_tree_string(&entry->tree, &entry->tokens) != 0)
+        goto fail;
+
+    for (uint32_t n = 0; n < entry->tree.num_nodes; n++)
+    {
+        int nt_index;
+        if ((nt_index = is_non_terminal(entry->tree.nodes[n].symbol)) != -1
+            && push_node_ref(&corpus->by_symbol[nt_index], (NodeRef) {index, n}) != 0)
+        {
+            // Only this entry's references can have been added.
+            for (size_t nt = 0; nt < corpus->grammar->num_non_terminals; nt++)
+            {
+                NodeRefList* list = &corpus->by_symbol[nt];
+                while (list->count > 0 && list->refs[list->count - 1].entry == index)
+                    list->count--;
+            }
+            goto fail;
+        }
+    }
+
+    corpus->num_entries++;
+    return 0;
+
+fail:
+    breakdown_derivation_tree(&entry->tree);
+    breakdown_token_array(&entry->tokens);
+    return -1;
+}
+
+int init_mutator(Mutator* m, Fuzzer* fuzzer, const Corpus* corpus,
+    uint32_t max_recursions)
+{
+    memset(m, 0, sizeof(Mutator));
+    m->fuzzer = fuzzer;
+    m->corpus = corpus;
+    m->max_recursions = max_recursions > 0 ? max_recursions : 1;
+    if (init_derivation_tree(&m->tree, corpus->grammar, 0) != 0
+        || init_token_array(&m->tokens, 0) != 0)
+    {
+        breakdown_mutator(m);
+        return -1;
+    }
+    return 0;
+}
+
+void breakdown_mutator(Mutator* m)
+{
+    breakdown_derivation_tree(&m->tree);
+    breakdown_token_array(&m->tokens);
+    memset(m, 0, sizeof(Mutator));
+}
+
+// Makes node `target` of the mutant expand like node `source`, whose
+// descendants have been copied to the run starting at `base`.
+static void relink_node(Mutator* m, uint32_t target, const DerivationNode* source,
+    uint32_t base)
+{
+    DerivationNode* node = &m->tree.nodes[target];
+    node->rule = source->rule;
+    node->first_child = source->first_child != DERIVATION_NONE ? base : DERIVATION_NONE;
+}
+
+// Appends the tokens of `entry` from `begin` up to `end`.
+static int append_span(Mutator* m, const CorpusEntry* entry, uint32_t begin,
+    uint32_t end)
+{
+    return token_array_append(&m->tokens, entry->tokens.tokens + begin, end - begin);
+}
+
+static int regenerate(Mutator* m, const CorpusEntry* seed, uint32_t target)
+{
+    const DerivationNode* node = &seed->tree.nodes[target];
+    uint32_t end = node->token_start + node->token_len;
+    if (append_span(m, seed, 0, node->token_start) != 0)
+        return -1;
+
+    uint32_t subtree = derive_subtree(node->symbol, m->fuzzer, &m->tree, &m->tokens);
+    if (subtree == DERIVATION_NONE)
+        return -1;
+    // The subtree's root is left behind in the arena, unreachable.
+    relink_node(m, target, &m->tree.nodes[subtree], subtree + 1);
+
+    return append_span(m, seed, end, seed->tree.num_tokens);
+}
+
+static int splice(Mutator* m, const CorpusEntry* seed, size_t seed_index,
+    uint32_t target)
+{
+    const DerivationNode* node = &seed->tree.nodes[target];
+    const NodeRefList* list = &m->corpus->by_symbol[is_non_terminal(node->symbol)];
+    if (list->count < 2)
+        return 1;
+
+    // The list holds `target` itself, so pick until it is another node.
+    NodeRef ref;
+    do
+    {
+        ref = list->refs[rng_bounded(&m->fuzzer->rng, list->count)];
+    } while (ref.entry == seed_index && ref.node == target);
+
+    const CorpusEntry* donor = &m->corpus->entries[ref.entry];
+    const DerivationNode* source = &donor->tree.nodes[ref.node];
+    uint32_t base = append_derivation_nodes(&m->tree, &donor->tree, ref.node + 1,
+        derivation_subtree_end(&donor->tree, ref.node));
+    if (base == DERIVATION_NONE)
+        return -1;
+    relink_node(m, target, source, base);
+
+    if (append_span(m, seed, 0, node->token_start) != 0
+        || append_span(m, donor, source->token_start,
+            source->token_start + source->token_len) != 0)
+        return -1;
+    return append_span(m, seed, node->token_start + node->token_len,
+        seed->tree.num_tokens);
+}
+
+static int recurse(Mutator* m, const CorpusEntry* seed)
+{
+    const DerivationTree* tree = &seed->tree;
+    Rng* rng = &m->fuzzer->rng;
+
+    // Look for a node `outer` with a descendant `inner` of the same
+    // non-terminal, picking `inner` uniformly among the candidates.
+    uint32_t outer = 0, inner = DERIVATION_NONE, end = 0;
+    for (size_t i = 0; i < RECURSE_ATTEMPTS && inner == DERIVATION_NONE; i++)
+    {
+        outer = rng_bounded(rng, tree->num_nodes);
+        end = derivation_subtree_end(tree, outer);
+        uint32_t seen = 0;
+        for (uint32_t n = outer + 1; n < end; n++)
+        {
+            if (tree->nodes[n].symbol == tree->nodes[outer].symbol
+                && rng_bounded(rng, ++seen) == 0)
+                inner = n;
+        }
+    }
+    if (inner == DERIVATION_NONE)
+        return 1;
+
+    // `outer` derives x `inner` y, and `inner` derives w. Expanding `inner`
+    // like `outer` k times derives x^(k+1) w y^(k+1). Each repetition is a
+    // copy of the descendants of `outer`, all taken before any are relinked.
+    uint32_t repeats = 1 + rng_bounded(rng, m->max_recursions);
+    uint32_t first_base = m->tree.num_nodes;
+    uint32_t size = end - (outer + 1);
+    for (uint32_t i = 0; i < repeats; i++)
+    {
+        if (append_derivation_nodes(&m->tree, &m->tree, outer + 1, end) == DERIVATION_NONE)
+            return -1;
+    }
+
+    // `inner` expands into the first copy, the copy of `inner` in that into
+    // the second, and so on. The last copy of `inner` keeps its expansion.
+    uint32_t link = inner;
+    for (uint32_t i = 0; i < repeats; i++)
+    {
+        uint32_t base = first_base + i * size;
+        relink_node(m, link, &tree->nodes[outer], base);
+        link = inner - (outer + 1) + base;
+    }
+
+    const DerivationNode* o = &tree->nodes[outer];
+    const DerivationNode* n = &tree->nodes[inner];
+    uint32_t o_end = o->token_start + o->token_len;
+    uint32_t n_end = n->token_start + n->token_len;
+    if (append_span(m, seed, 0, o->token_start) != 0)
+        return -1;
+    for (uint32_t i = 0; i <= repeats; i++)
+    {
+        if (append_span(m, seed, o->token_start, n->token_start) != 0)
+            return -1;
+    }
+    if (append_span(m, seed, n->token_start, n_end) != 0)
+        return -1;
+    for (uint32_t i = 0; i <= repeats; i++)
+    {
+        if (append_span(m, seed, n_end, o_end) != 0)
+            return -1;
+    }
+    return append_span(m, seed, o_end, tree->num_tokens);
+}
+
+// Applies one mutation to the mutant, which is a fresh copy of `seed`.
+static int apply_mutation(Mutator* m, const CorpusEntry* seed, size_t seed_index,
+    MutationType type)
+{
+    uint32_t target = rng_bounded(&m->fuzzer->rng, seed->tree.num_nodes);
+    switch (type)
+    {
+        case MUTATE_REGENERATE:
+            return regenerate(m, seed, target);
+        case MUTATE_SPLICE:
+            return splice(m, seed, seed_index, target);
+        case MUTATE_RECURSE:
+            return recurse(m, seed);
+        default:
+            return -1;
+    }
+}
+
+int mutate(Mutator* m, size_t entry, MutationType type)
+{
+    const CorpusEntry* seed = &m->corpus->entries[entry];
+    const DerivationTree* tree = &seed->tree;
+    if (tree->nodes[tree->root].rule == DERIVATION_NONE)
+        return 1;
+
+    // Only the mutated subtree is added to the copy.
+    if (copy_derivation_tree(&m->tree, tree) != 0)
+        return -1;
+    clear_token_array(&m->tokens);
+
+    int ret;
+    if (type != MUTATE_ANY)
+        ret = apply_mutation(m, seed, entry, type);
+    else
+    {
+        // A mutation which does not apply has not changed the mutant yet.
+        type = MUTATE_REGENERATE + rng_bounded(&m->fuzzer->rng, NUM_MUTATION_TYPES - 1);
+        if ((ret = apply_mutation(m, seed, entry, type)) == 1)
+            ret = apply_mutation(m, seed, entry, MUTATE_REGENERATE);
+    }
+
+    if (ret == 0 && m->tokens.index >= UINT32_MAX)
+        ret = -1;
+    m->tree.num_tokens = m->tokens.index;
+    return ret;
+}
@@ -0,0 +1,155 @@
+#include "../../include/fuzzer/parallel.h"
+
+#include <string.h>
+#include <unistd.h>
+
+static void* run_worker(void* arg)
+{
+    FuzzWorker* worker = arg;
+    ParallelFuzzer* pf = worker->pf;
+
+    // Both rings are closed to stop the workers.
+    FuzzBatch* batch;
+    while (!atomic_load(&pf->empty.closed) && (batch = ring_pop(&pf->empty)) != NULL)
+    {
+        if (fuzz_batch(pf->key, pf->batch_size, &worker->fuzzer, batch) != 0)
+        {
+            atomic_store(&pf->error, 1);
+            close_ring(&pf->ready);
+            close_ring(&pf->empty);
+            break;
+        }
+        // `ready` has room for every batch, so this never waits.
+        if (ring_push(&pf->ready, batch) != 0)
+            break;
+    }
+
+    return NULL;
+}
+
+// Frees everything allocated for `pf`, once no worker is running.
+static void free_parallel_fuzzer(ParallelFuzzer* pf)
+{
+    if (pf->workers != NULL)
+    {
+        for (size_t i = 0; i < pf->num_workers; i++)
+        {
+            breakdown_fuzzer(&pf->workers[i].fuzzer);
+        }
+    }
+    if (pf->pool != NULL)
+    {
+        for (size_t i = 0; i < pf->num_batches; i++)
+        {
+            breakdown_fuzz_batch(&pf->pool[i]);
+        }
+    }
+    free(pf->workers);
+    free(pf->pool);
+    breakdown_ring(&pf->ready);
+    breakdown_ring(&pf->empty);
+    memset(pf, 0, sizeof(ParallelFuzzer));
+}
+
+int start_parallel_fuzzer(ParallelFuzzer* pf, const Grammar* grammar,
+    Token key, size_t num_threads, size_t batch_size, uint64_t seed)
+{
+    if (num_threads == 0)
+    {
+        long cores = sysconf(_SC_NPROCESSORS_ONLN);
+        num_threads = cores > 0 ? (size_t) cores : 1;
+    }
+
+    memset(pf, 0, sizeof(ParallelFuzzer));
+    pf->key = key;
+    pf->batch_size = batch_size;
+    pf->num_batches = num_threads * BATCHES_PER_WORKER;
+    atomic_init(&pf->error, 0);
+
+    pf->workers = calloc(num_threads, sizeof(FuzzWorker));
+    pf->pool = calloc(pf->num_batches, sizeof(FuzzBatch));
+    if (pf->workers == NULL || pf->pool == NULL
+        || init_ring(&pf->ready, pf->num_batches) != 0
+        || init_ring(&pf->empty, pf->num_batches) != 0)
+    {
+        free_parallel_fuzzer(pf);
+        return -1;
+    }
+
+    for (size_t i = 0; i < pf->num_batches; i++)
+    {
+        if (init_fuzz_batch(&pf->pool[i], batch_size, 0) != 0)
+        {
+            free_parallel_fuzzer(pf);
+            return -1;
+        }
+        ring_try_push(&pf->empty, &pf->pool[i]);
+    }
+
+    // Every worker gets its own non-overlapping stream of the one seed.
+    Rng parent;
+    rng_seed(&parent, seed);
+    for (size_t i = 0; i < num_threads; i++)
+    {
+        FuzzWorker* worker = &pf->workers[i];
+        worker->pf = pf;
+        if (init_fuzzer(&worker->fuzzer, grammar, 0) != 0)
+        {
+            free_parallel_fuzzer(pf);
+            return -1;
+        }
+        rng_split(&parent, &worker->fuzzer.rng);
+        pf->num_workers++;
+    }
+
+    for (size_t i = 0; i < num_threads; i++)
+    {
+        if (pthread_create(&pf->workers[i].thread, NULL, run_worker,
+                &pf->workers[i]) != 0)
+        {
+            // Only the first `i` workers are running.
+            close_ring(&pf->ready);
+            close_ring(&pf->empty);
+            for (size_t j = 0; j < i; j++)
+            {
+                pthread_join(pf->workers[j].thread, NULL);
+            }
+            free_parallel_fuzzer(pf);
+            return -1;
+        }
+    }
+
+    return 0;
+}
+
+FuzzBatch* parallel_fuzzer_next(ParallelFuzzer* pf)
+{
+    FuzzBatch* batch;
+    return parallel_fuzzer_next_batches(pf, &batch, 1) == 1 ? batch : NULL;
+}
+
+size_t parallel_fuzzer_next_batches(ParallelFuzzer* pf, FuzzBatch** batches,
+    size_t max_batches)
+{
+    if (atomic_load(&pf->error) || atomic_load(&pf->ready.closed))
+        return 0;
+    return ring_pop_batch(&pf->ready, (void**) batches, max_batches);
+}
+
+void parallel_fuzzer_release(ParallelFuzzer* pf, FuzzBatch* batch)
+{
+    // `empty` has room for every batch, so this never waits.
+    ring_push(&pf->empty, batch);
+}
+
+void stop_parallel_fuzzer(ParallelFuzzer* pf)
+{
+    close_ring(&pf->ready);
+    close_ring(&pf->empty);
+
+    for (size_t i = 0; i < pf->num_workers; i++)
+    {
+        pthread_join(pf->workers[i].thread, NULL);
+    }
+    free_parallel_fuzzer(pf);
+}
@@ -0,0 +1,196 @@
+#include "../../include/fuzzer/ring.h"
+
+#include <sched.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+// A waiting thread spins this many times, then yields this many times, and
+// then sleeps for RING_SLEEP_NS between tries.
+#define RING_SPINS 64
+#define RING_YIELDS 1024
+#define RING_SLEEP_NS 50000
+
+int init_ring(Ring* ring, size_t capacity)
+{
+    memset(ring, 0, sizeof(Ring));
+    size_t num_slots = 2;
+    while (num_slots < capacity)
+        num_slots *= 2;
+
+    ring->slots = malloc(num_slots * sizeof(RingSlot));
+    if (ring->slots == NULL)
+        return -1;
+    ring->mask = num_slots - 1;
+    for (size_t i = 0; i < num_slots; i++)
+    {
+        atomic_init(&ring->slots[i].sequence, i);
+        ring->slots[i].item = NULL;
+    }
+    atomic_init(&ring->closed, 0);
+    atomic_init(&ring->head, 0);
+    atomic_init(&ring->tail, 0);
+    atomic_init(&ring->pushes, 0);
+    atomic_init(&ring->pops, 0);
+    atomic_init(&ring->full_waits, 0);
+    atomic_init(&ring->empty_waits, 0);
+    atomic_init(&ring->occupancy_sum, 0);
+    return 0;
+}
+
+void breakdown_ring(Ring* ring)
+{
+    free(ring->slots);
+    memset(ring, 0, sizeof(Ring));
+}
+
+void close_ring(Ring* ring)
+{
+    atomic_store(&ring->closed, 1);
+}
+
+// Waits a little longer each time it is called for the same wait.
+static void back_off(unsigned* tries)
+{
+    if (*tries >= RING_SPINS + RING_YIELDS)
+    {
+        struct timespec ts = {0, RING_SLEEP_NS};
+        nanosleep(&ts, NULL);
+    }
+    else if (*tries >= RING_SPINS)
+    {
+        sched_yield();
+        (*tries)++;
+    }
+    else
+        (*tries)++;
+}
+
+int ring_try_push(Ring* ring, void* item)
+{
+    size_t pos = atomic_load_explicit(&ring->tail, memory_order_relaxed);
+    RingSlot* slot;
+    for (;;)
+    {
+        slot = &ring->slots[pos & ring->mask];
+        size_t sequence = atomic_load_explicit(&slot->sequence, memory_order_acquire);
+        intptr_t diff = (intptr_t) sequence - (intptr_t) pos;
+        if (diff == 0)
+        {
+            if (atomic_compare_exchange_weak_explicit(&ring->tail, &pos, pos + 1,
+                    memory_order_relaxed, memory_order_relaxed))
+                break;
+        }
+        else if (diff < 0)
+            return -1;
+        else
+            pos = atomic_load_explicit(&ring->tail, memory_order_relaxed);
+    }
+    slot->item = item;
+    atomic_store_explicit(&slot->sequence, pos + 1, memory_order_release);
+
+    // The head may have passed this item already, hence the clamp.
+    size_t head = atomic_load_explicit(&ring->head, memory_order_relaxed);
+    size_t occupancy = pos + 1 > head ? pos + 1 - head : 0;
+    atomic_fetch_add_explicit(&ring->pushes, 1, memory_order_relaxed);
+    atomic_fetch_add_explicit(&ring->occupancy_sum, occupancy, memory_order_relaxed);
+    return 0;
+}
+
+int ring_push(Ring* ring, void* item)
+{
+    unsigned tries = 0;
+    while (ring_try_push(ring, item) != 0)
+    {
+        if (atomic_load(&ring->closed))
+            return -1;
+        if (tries == 0)
+            atomic_fetch_add_explicit(&ring->full_waits, 1, memory_order_relaxed);
+        back_off(&tries);
+    }
+    return 0;
+}
+
+size_t ring_try_pop_batch(Ring* ring, void** items, size_t max_items)
+{
+    if (max_items == 0)
+        return 0;
+
+    size_t pos = atomic_load_explicit(&ring->head, memory_order_relaxed);
+    size_t count;
+    for (;;)
+    {
+        // Count the filled slots from `pos`, up to `max_items`.
+        RingSlot* slot = &ring->slots[pos & ring->mask];
+        size_t sequence = atomic_load_explicit(&slot->sequence, memory_order_acquire);
+        intptr_t diff = (intptr_t) sequence - (intptr_t) (pos + 1);
+        if (diff < 0)
+            return 0;
+        if (diff > 0)
+        {
+            pos = atomic_load_explicit(&ring->head, memory_order_relaxed);
+            continue;
+        }
+        for (count = 1; count < max_items; count++)
+        {
+            slot = &ring->slots[(pos + count) & ring->mask];
+            sequence = atomic_load_explicit(&slot->sequence, memory_order_acquire);
+            if (sequence != pos + count + 1)
+                break;
+        }
+
+        // Claim every counted slot at once.
+        if (atomic_compare_exchange_weak_explicit(&ring->head, &pos, pos + count,
+                memory_order_relaxed, memory_order_relaxed))
+            break;
+    }
+
+    for (size_t i = 0; i < count; i++)
+    {
+        RingSlot* slot = &ring->slots[(pos + i) & ring->mask];
+        items[i] = slot->item;
+        atomic_store_explicit(&slot->sequence, pos + i + ring->mask + 1,
+            memory_order_release);
+    }
+    atomic_fetch_add_explicit(&ring->pops, count, memory_order_relaxed);
+    return count;
+}
+
+size_t ring_pop_batch(Ring* ring, void** items, size_t max_items)
+{
+    unsigned tries = 0;
+    size_t count;
+    while ((count = ring_try_pop_batch(ring, items, max_items)) == 0)
+    {
+        if (atomic_load(&ring->closed) || max_items == 0)
+            return 0;
+        if (tries == 0)
+            atomic_fetch_add_explicit(&ring->empty_waits, 1, memory_order_relaxed);
+        back_off(&tries);
+    }
+    return count;
+}
+
+void* ring_pop(Ring* ring)
+{
+    void* item;
+    return ring_pop_batch(ring, &item, 1) == 1 ? item : NULL;
+}
+
+size_t ring_occupancy(Ring* ring)
+{
+    size_t head = atomic_load(&ring->head);
+    size_t tail = atomic_load(&ring->tail);
+    return tail > head ? tail - head : 0;
+}
+
+void ring_stats(Ring* ring, RingStats* stats)
+{
+    stats->pushes = atomic_load(&ring->pushes);
+    stats->pops = atomic_load(&ring->pops);
+    stats->full_waits = atomic_load(&ring->full_waits);
+    stats->empty_waits = atomic_load(&ring->empty_waits);
+    size_t sum = atomic_load(&ring->occupancy_sum);
+    stats->mean_occupancy = stats->pushes > 0 ? (double) sum / stats->pushes : 0.0;
+}
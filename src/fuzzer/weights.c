@@ -0,0 +1,159 @@
+#include "../../include/fuzzer/weights.h"
+
+#include <math.h>
+#include <string.h>
+
+// Rebuilds the alias table of non-terminal `nt_index` from its weights
+// using Vose's algorithm.
+static void build_alias_table(RuleWeights* rw, size_t nt_index)
+{
+    const Grammar* grammar = rw->grammar;
+    size_t first = grammar_first_rule(grammar, nt_index);
+    size_t n = grammar_num_rules(grammar, nt_index);
+
+    double total = 0;
+    for (size_t i = 0; i < n; i++)
+    {
+        total += rw->weights[first + i];
+    }
+
+    // Scale the weights so that they average 1. Slots below 1 are "small"
+    // and are topped up by an alias from the "large" ones. Small slots are
+    // kept at the start of `work`, large slots at the end.
+    size_t num_small = 0;
+    size_t num_large = 0;
+    for (size_t i = 0; i < n; i++)
+    {
+        rw->scaled[i] = total > 0 ? rw->weights[first + i] * n / total : 1;
+        if (rw->scaled[i] < 1)
+            rw->work[num_small++] = i;
+        else
+            rw->work[n - ++num_large] = i;
+    }
+
+    while (num_small > 0 && num_large > 0)
+    {
+        uint32_t small = rw->work[--num_small];
+        uint32_t large = rw->work[n - num_large];
+
+        rw->threshold[first + small] = (uint32_t) (rw->scaled[small] * 4294967296.0);
+        rw->alias[first + small] = first + large;
+
+        rw->scaled[large] -= 1 - rw->scaled[small];
+        if (rw->scaled[large] < 1)
+        {
+            num_large--;
+            rw->work[num_small++] = large;
+        }
+    }
+
+    // Whatever is left is 1 up to rounding error, so always keeps its slot.
+    while (num_large > 0)
+    {
+        uint32_t i = rw->work[n - num_large--];
+        rw->threshold[first + i] = UINT32_MAX;
+        rw->alias[first + i] = first + i;
+    }
+    while (num_small > 0)
+    {
+        uint32_t i = rw->work[--num_small];
+        rw->threshold[first + i] = UINT32_MAX;
+        rw->alias[first + i] = first + i;
+    }
+}
+
+int init_rule_weights(RuleWeights* rw, const Grammar* grammar,
+    const double* weights)
+{
+    memset(rw, 0, sizeof(RuleWeights));
+    rw->grammar = grammar;
+
+    size_t max_rules = 1;
+    for (size_t nt = 0; nt < grammar->num_non_terminals; nt++)
+    {
+        if (grammar_num_rules(grammar, nt) > max_rules)
+            max_rules = grammar_num_rules(grammar, nt);
+    }
+
+    size_t num_rules = grammar->num_rules + 1;
+    rw->weights = malloc(num_rules * sizeof(double));
+    rw->threshold = malloc(num_rules * sizeof(uint32_t));
+    rw->alias = malloc(num_rules * sizeof(uint32_t));
+    rw->scaled = malloc(max_rules * sizeof(double));
+    rw->work = malloc(max_rules * sizeof(uint32_t));
+    if (rw->weights == NULL || rw->threshold == NULL || rw->alias == NULL
+        || rw->scaled == NULL || rw->work == NULL)
+    {
+        breakdown_rule_weights(rw);
+        return -1;
+    }
+
+    for (size_t r = 0; r < grammar->num_rules; r++)
+    {
+        double weight = weights != NULL ? weights[r] : 1;
+        if (!isfinite(weight) || weight < 0)
+        {
+            breakdown_rule_weights(rw);
+            return -1;
+        }
+        rw->weights[r] = weight;
+    }
+
+    for (size_t nt = 0; nt < grammar->num_non_terminals; nt++)
+    {
+        build_alias_table(rw, nt);
+    }
+
+    return 0;
+}
+
+void breakdown_rule_weights(RuleWeights* rw)
+{
+    free(rw->weights);
+    free(rw->threshold);
+    free(rw->alias);
+    free(rw->scaled);
+    free(rw->work);
+    memset(rw, 0, sizeof(RuleWeights));
+}
+
+int set_rule_weight(RuleWeights* rw, size_t rule_index, double weight)
+{
+    if (rule_index >= rw->grammar->num_rules || !isfinite(weight) || weight < 0)
+        return -1;
+    rw->weights[rule_index] = weight;
+
+    // Find the non-terminal owning the rule: the last one whose first rule
+    // is at or before it.
+    const uint32_t* offsets = rw->grammar->rule_offsets;
+    size_t low = 0;
+    size_t high = rw->grammar->num_non_terminals;
+    while (high - low > 1)
+    {
+        size_t mid = low + (high - low) / 2;
+        if (offsets[mid] <= rule_index)
+            low = mid;
+        else
+            high = mid;
+    }
+
+    build_alias_table(rw, low);
+    return 0;
+}
+
+int update_rule_weights(RuleWeights* rw, const double* weights)
+{
+    const Grammar* grammar = rw->grammar;
+    for (size_t r = 0; r < grammar->num_rules; r++)
+    {
+        if (!isfinite(weights[r]) || weights[r] < 0)
+            return -1;
+    }
+
+    memcpy(rw->weights, weights, grammar->num_rules * sizeof(double));
+    for (size_t nt = 0; nt < grammar->num_non_terminals; nt++)
+    {
+        build_alias_table(rw, nt);
+    }
+    return 0;
+}
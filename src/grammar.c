@@ -1,9 +1,93 @@
 #include "../include/grammar.h"
 
+#include <string.h>
+
 int is_non_terminal(Token key) 
 {
-    if ((key & 0x80) == 0x80) {
-        return key & 0x0F;
+    if ((key & NON_TERMINAL_FLAG) == NON_TERMINAL_FLAG) {
+        return key & NON_TERMINAL_MASK;
     }
     return -1;
-}
\ No newline at end of file
+}
+
+int init_token_array(TokenArray* arr, size_t capacity)
+{
+    arr->index = 0;
+    arr->capacity = 0;
+    arr->tokens = NULL;
+    arr->sink = NULL;
+    arr->sink_ctx = NULL;
+
+    if (capacity > 0)
+    {
+        arr->tokens = malloc(capacity * sizeof(Token));
+        if (arr->tokens == NULL)
+            return -1;
+        arr->capacity = capacity;
+    }
+    return 0;
+}
+
+int init_token_array_sink(TokenArray* arr, size_t capacity, TokenSink sink,
+    void* ctx)
+{
+    if (capacity == 0 || init_token_array(arr, capacity) != 0)
+        return -1;
+    arr->sink = sink;
+    arr->sink_ctx = ctx;
+    return 0;
+}
+
+void breakdown_token_array(TokenArray* arr)
+{
+    free(arr->tokens);
+    arr->index = 0;
+    arr->capacity = 0;
+    arr->tokens = NULL;
+}
+
+void clear_token_array(TokenArray* arr)
+{
+    arr->index = 0;
+}
+
+int flush_token_array(TokenArray* arr)
+{
+    if (arr->sink == NULL || arr->index == 0)
+        return 0;
+
+    size_t num_tokens = arr->index;
+    arr->index = 0;
+    return arr->sink(arr->tokens, num_tokens, arr->sink_ctx) == 0 ? 0 : -1;
+}
+
+int token_array_make_room(TokenArray* arr)
+{
+    if (arr->sink != NULL)
+        return flush_token_array(arr);
+
+    size_t capacity = arr->capacity ? arr->capacity * 2 : TOKEN_ARRAY_INITIAL_CAPACITY;
+    Token* tokens = realloc(arr->tokens, capacity * sizeof(Token));
+    if (tokens == NULL)
+        return -1;
+    arr->tokens = tokens;
+    arr->capacity = capacity;
+    return 0;
+}
+
+int token_array_append(TokenArray* arr, const Token* tokens, size_t num_tokens)
+{
+    while (num_tokens > 0)
+    {
+        if (arr->index == arr->capacity && token_array_make_room(arr) != 0)
+            return -1;
+        size_t chunk = arr->capacity - arr->index;
+        if (chunk > num_tokens)
+            chunk = num_tokens;
+        memcpy(arr->tokens + arr->index, tokens, chunk * sizeof(Token));
+        arr->index += chunk;
+        tokens += chunk;
+        num_tokens -= chunk;
+    }
+    return 0;
+}
@@ -0,0 +1,254 @@
+#include "../include/grammar_file.h"
+
+#include <fcntl.h>
+#include <math.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+// Returns 1 if `count` elements of `size` bytes starting at byte `offset`
+// fit inside a mapping of `map_size` bytes, otherwise 0.
+static int section_fits(uint64_t offset, uint64_t count, size_t size,
+    size_t map_size)
+{
+    if (offset > map_size || offset % sizeof(uint32_t) != 0)
+        return 0;
+    return count <= (map_size - offset) / size;
+}
+
+// Returns 1 if the `count + 1` entries of `offsets` are non-decreasing, start
+// at `first` and end at `last`.
+static int offsets_valid(const uint32_t* offsets, size_t count, size_t first,
+    size_t last)
+{
+    if (offsets[0] != first || offsets[count] != last)
+        return 0;
+
+    for (size_t i = 0; i < count; i++)
+    {
+        if (offsets[i] > offsets[i + 1])
+            return 0;
+    }
+    return 1;
+}
+
+static int validate_grammar_file(GrammarFile* gf)
+{
+    const GrammarFileHeader* header = gf->map;
+    const uint8_t* base = gf->map;
+
+    if (gf->map_size < sizeof(GrammarFileHeader)
+        || memcmp(header->magic, GRAMMAR_FILE_MAGIC, 4) != 0)
+    {
+        fprintf(stderr, "not a binary grammar file\n");
+        return -1;
+    }
+
+    if (header->version != GRAMMAR_FILE_VERSION)
+    {
+        fprintf(stderr, "unsupported grammar file version %u (expected %u)\n",
+            header->version, GRAMMAR_FILE_VERSION);
+        return -1;
+    }
+
+    if (header->token_bits != sizeof(Token) * 8)
+    {
+        fprintf(stderr, "grammar file uses %u-bit tokens but this build uses "
+            "%zu-bit tokens\n", header->token_bits, sizeof(Token) * 8);
+        return -1;
+    }
+
+    if (header->num_non_terminals > MAX_NON_TERMINALS
+        || header->num_terminals > NON_TERMINAL_FLAG)
+    {
+        fprintf(stderr, "grammar file has too many symbols for %zu-bit "
+            "tokens\n", sizeof(Token) * 8);
+        return -1;
+    }
+
+    size_t map_size = gf->map_size;
+    if (!section_fits(header->rule_offsets,
+            header->num_non_terminals + 1ull, sizeof(uint32_t), map_size)
+        || !section_fits(header->token_offsets,
+            header->num_rules + 1ull, sizeof(uint32_t), map_size)
+        || !section_fits(header->tokens,
+            header->num_tokens, sizeof(Token), map_size)
+        || !section_fits(header->terminal_lengths,
+            header->num_terminals, sizeof(uint32_t), map_size)
+        || !section_fits(header->terminal_strs,
+            header->num_terminals + 1ull, sizeof(uint32_t), map_size)
+        || !section_fits(header->non_terminal_strs,
+            header->num_non_terminals + 1ull, sizeof(uint32_t), map_size)
+        || !section_fits(header->strings,
+            header->strings_size, 1, map_size)
+        || !section_fits(header->rule_weights,
+            header->num_rules, sizeof(double), map_size)
+        || header->rule_weights % sizeof(double) != 0)
+    {
+        fprintf(stderr, "grammar file is truncated\n");
+        return -1;
+    }
+
+    Grammar* grammar = &gf->grammar;
+    grammar->num_non_terminals = header->num_non_terminals;
+    grammar->num_rules = header->num_rules;
+    grammar->num_tokens = header->num_tokens;
+    grammar->rule_offsets = (const uint32_t*) (base + header->rule_offsets);
+    grammar->token_offsets = (const uint32_t*) (base + header->token_offsets);
+    grammar->tokens = (const Token*) (base + header->tokens);
+
+    gf->num_terminals = header->num_terminals;
+    gf->terminal_lengths = (const uint32_t*) (base + header->terminal_lengths);
+    gf->terminal_strs = (const uint32_t*) (base + header->terminal_strs);
+    gf->non_terminal_strs = (const uint32_t*) (base + header->non_terminal_strs);
+    gf->strings = (const char*) (base + header->strings);
+    gf->rule_weights = (const double*) (base + header->rule_weights);
+
+    if (!offsets_valid(grammar->rule_offsets, grammar->num_non_terminals,
+            0, grammar->num_rules)
+        || !offsets_valid(grammar->token_offsets, grammar->num_rules,
+            0, grammar->num_tokens)
+        || !offsets_valid(gf->terminal_strs, gf->num_terminals,
+            0, gf->non_terminal_strs[0])
+        || !offsets_valid(gf->non_terminal_strs, grammar->num_non_terminals,
+            gf->terminal_strs[gf->num_terminals], header->strings_size))
+    {
+        fprintf(stderr, "grammar file has corrupt offsets\n");
+        return -1;
+    }
+
+    // The fuzzer picks one of every non-terminal's rules, so each needs one.
+    for (size_t i = 0; i < grammar->num_non_terminals; i++)
+    {
+        if (grammar->rule_offsets[i] == grammar->rule_offsets[i + 1])
+        {
+            fprintf(stderr, "grammar file has a non-terminal with no rules\n");
+            return -1;
+        }
+    }
+
+    // Every name must be NUL-terminated so it can be used as a C string.
+    for (size_t i = 0; i < grammar->num_non_terminals; i++)
+    {
+        uint32_t end = gf->non_terminal_strs[i + 1];
+        if (gf->non_terminal_strs[i] >= end || gf->strings[end - 1] != '\0')
+        {
+            fprintf(stderr, "grammar file has a corrupt string pool\n");
+            return -1;
+        }
+    }
+    for (size_t i = 0; i < gf->num_terminals; i++)
+    {
+        uint32_t end = gf->terminal_strs[i + 1];
+        if (gf->terminal_strs[i] >= end || gf->strings[end - 1] != '\0')
+        {
+            fprintf(stderr, "grammar file has a corrupt string pool\n");
+            return -1;
+        }
+    }
+
+    for (size_t i = 0; i < grammar->num_rules; i++)
+    {
+        if (!isfinite(gf->rule_weights[i]) || gf->rule_weights[i] < 0)
+        {
+            fprintf(stderr, "grammar file has an invalid weight for rule %zu\n",
+                i);
+            return -1;
+        }
+    }
+
+    // Every token must name a symbol that exists in the grammar.
+    for (size_t i = 0; i < grammar->num_tokens; i++)
+    {
+        Token key = grammar->tokens[i];
+        int nt_index = is_non_terminal(key);
+        if (nt_index != -1)
+        {
+            if ((size_t) nt_index >= grammar->num_non_terminals)
+            {
+                fprintf(stderr, "grammar file references unknown "
+                    "non-terminal 0x%x\n", key);
+                return -1;
+            }
+        }
+        else if (key >= gf->num_terminals)
+        {
+            fprintf(stderr, "grammar file references unknown terminal 0x%x\n",
+                key);
+            return -1;
+        }
+    }
+
+    return 0;
+}
+
+int load_grammar_file(GrammarFile* gf, const char* path)
+{
+    int fd = open(path, O_RDONLY);
+    if (fd == -1)
+    {
+        perror(path);
+        return -1;
+    }
+
+    struct stat st;
+    if (fstat(fd, &st) == -1)
+    {
+        perror(path);
+        close(fd);
+        return -1;
+    }
+
+    gf->map_size = st.st_size;
+    gf->map = gf->map_size > 0
+        ? mmap(NULL, gf->map_size, PROT_READ, MAP_PRIVATE, fd, 0)
+        : MAP_FAILED;
+    close(fd);
+
+    if (gf->map == MAP_FAILED)
+    {
+        fprintf(stderr, "%s: unable to map grammar file\n", path);
+        return -1;
+    }
+
+    if (validate_grammar_file(gf) != 0)
+    {
+        munmap(gf->map, gf->map_size);
+        return -1;
+    }
+
+    return 0;
+}
+
+void unload_grammar_file(GrammarFile* gf)
+{
+    if (gf->map != NULL)
+        munmap(gf->map, gf->map_size);
+    gf->map = NULL;
+    gf->map_size = 0;
+}
+
+const char* grammar_file_token_str(const GrammarFile* gf, Token key)
+{
+    int nt_index;
+    if ((nt_index = is_non_terminal(key)) != -1)
+    {
+        if ((size_t) nt_index >= gf->grammar.num_non_terminals)
+            return NULL;
+        return gf->strings + gf->non_terminal_strs[nt_index];
+    }
+
+    if (key >= gf->num_terminals)
+        return NULL;
+    return gf->strings + gf->terminal_strs[key];
+}
+
+void write_grammar_file_token(const GrammarFile* gf, Token key, FILE* out)
+{
+    const char* name = gf != NULL ? grammar_file_token_str(gf, key) : NULL;
+    if (name != NULL)
+        fprintf(out, "%s", name);
+    else
+        fprintf(out, "0x%x", key);
+}
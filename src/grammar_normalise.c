@@ -0,0 +1,333 @@
+#include "../include/grammar_normalise.h"
+
+#include <string.h>
+
+// A growable list of rules, each a view into the original grammar's pool.
+typedef struct RuleList
+{
+    Rule* rules;
+    size_t count;
+    size_t capacity;
+} RuleList;
+
+// Used to sort a RuleList by content while remembering the original order.
+typedef struct OrderedRule
+{
+    Rule rule;
+    size_t order;
+} OrderedRule;
+
+static int push_rule(RuleList* list, Rule rule)
+{
+    if (list->count == list->capacity)
+    {
+        size_t capacity = list->capacity ? list->capacity * 2 : 4;
+        Rule* rules = realloc(list->rules, capacity * sizeof(Rule));
+        if (rules == NULL)
+            return -1;
+        list->rules = rules;
+        list->capacity = capacity;
+    }
+    list->rules[list->count++] = rule;
+    return 0;
+}
+
+static int compare_rules(const Rule* a, const Rule* b)
+{
+    if (a->num_tokens != b->num_tokens)
+        return a->num_tokens < b->num_tokens ? -1 : 1;
+
+    for (size_t i = 0; i < a->num_tokens; i++)
+    {
+        if (a->tokens[i] != b->tokens[i])
+            return a->tokens[i] < b->tokens[i] ? -1 : 1;
+    }
+    return 0;
+}
+
+static int compare_by_content(const void* a, const void* b)
+{
+    const OrderedRule* ra = a;
+    const OrderedRule* rb = b;
+    int cmp = compare_rules(&ra->rule, &rb->rule);
+    if (cmp != 0)
+        return cmp;
+    return ra->order < rb->order ? -1 : (ra->order > rb->order);
+}
+
+static int compare_by_order(const void* a, const void* b)
+{
+    const OrderedRule* ra = a;
+    const OrderedRule* rb = b;
+    return ra->order < rb->order ? -1 : (ra->order > rb->order);
+}
+
+// Removes duplicate rules from `list`, keeping the first occurrence of each.
+static int dedupe_rules(RuleList* list)
+{
+    if (list->count < 2)
+        return 0;
+
+    OrderedRule* sorted = malloc(list->count * sizeof(OrderedRule));
+    if (sorted == NULL)
+        return -1;
+
+    for (size_t i = 0; i < list->count; i++)
+    {
+        sorted[i] = (OrderedRule) {list->rules[i], i};
+    }
+    qsort(sorted, list->count, sizeof(OrderedRule), compare_by_content);
+
+    size_t unique = 1;
+    for (size_t i = 1; i < list->count; i++)
+    {
+        if (compare_rules(&sorted[i].rule, &sorted[unique - 1].rule) != 0)
+            sorted[unique++] = sorted[i];
+    }
+    qsort(sorted, unique, sizeof(OrderedRule), compare_by_order);
+
+    for (size_t i = 0; i < unique; i++)
+    {
+        list->rules[i] = sorted[i].rule;
+    }
+    list->count = unique;
+
+    free(sorted);
+    return 0;
+}
+
+// Returns 1 if every token in `rule` is a terminal or a productive
+// non-terminal.
+static int rule_productive(Rule rule, const uint8_t* productive)
+{
+    for (size_t i = 0; i < rule.num_tokens; i++)
+    {
+        int nt_index = is_non_terminal(rule.tokens[i]);
+        if (nt_index != -1 && !productive[nt_index])
+            return 0;
+    }
+    return 1;
+}
+
+// Returns the index of the non-terminal if `rule` is a unit rule, else -1.
+static int unit_rule_target(Rule rule)
+{
+    if (rule.num_tokens != 1)
+        return -1;
+    return is_non_terminal(rule.tokens[0]);
+}
+
+int normalise_grammar(NormalisedGrammar* ng, const Grammar* grammar,
+    Token start)
+{
+    size_t num_nt = grammar->num_non_terminals;
+    int start_index = is_non_terminal(start);
+    if (start_index == -1 || (size_t) start_index >= num_nt)
+    {
+        fprintf(stderr, "start token 0x%x is not a non-terminal\n", start);
+        return -1;
+    }
+
+    int ret = -1;
+    memset(ng, 0, sizeof(NormalisedGrammar));
+
+    uint8_t* productive = calloc(num_nt, 1);
+    size_t* visited = calloc(num_nt, sizeof(size_t));
+    size_t* work = malloc(num_nt * sizeof(size_t));
+    int32_t* new_index = malloc(num_nt * sizeof(int32_t));
+    RuleList* rules = calloc(num_nt, sizeof(RuleList));
+    if (productive == NULL || visited == NULL || work == NULL
+        || new_index == NULL || rules == NULL)
+    {
+        fprintf(stderr, "out of memory normalising grammar\n");
+        goto cleanup;
+    }
+
+    // 1. Find the productive non-terminals by iterating to a fixed point.
+    int changed = 1;
+    while (changed)
+    {
+        changed = 0;
+        for (size_t nt = 0; nt < num_nt; nt++)
+        {
+            if (productive[nt])
+                continue;
+
+            size_t first_rule = grammar_first_rule(grammar, nt);
+            for (size_t i = 0; i < grammar_num_rules(grammar, nt); i++)
+            {
+                if (rule_productive(grammar_rule(grammar, first_rule + i),
+                        productive))
+                {
+                    productive[nt] = 1;
+                    changed = 1;
+                    break;
+                }
+            }
+        }
+    }
+
+    if (!productive[start_index])
+    {
+        fprintf(stderr, "start token 0x%x cannot derive any string\n", start);
+        goto cleanup;
+    }
+
+    // 2. Give every non-terminal the productive, non-unit rules of each
+    // non-terminal reachable from it through unit rules (itself included).
+    for (size_t nt = 0; nt < num_nt; nt++)
+    {
+        if (!productive[nt])
+            continue;
+
+        // `visited` holds the last non-terminal + 1 whose closure reached
+        // each non-terminal, so it need not be cleared between closures.
+        size_t num_work = 0;
+        work[num_work++] = nt;
+        visited[nt] = nt + 1;
+
+        for (size_t w = 0; w < num_work; w++)
+        {
+            size_t first_rule = grammar_first_rule(grammar, work[w]);
+            for (size_t i = 0; i < grammar_num_rules(grammar, work[w]); i++)
+            {
+                Rule rule = grammar_rule(grammar, first_rule + i);
+                if (!rule_productive(rule, productive))
+                    continue;
+
+                int target = unit_rule_target(rule);
+                if (target == -1)
+                {
+                    if (push_rule(&rules[nt], rule) != 0)
+                    {
+                        fprintf(stderr, "out of memory normalising grammar\n");
+                        goto cleanup;
+                    }
+                }
+                else if (visited[target] != nt + 1)
+                {
+                    visited[target] = nt + 1;
+                    work[num_work++] = target;
+                }
+            }
+        }
+
+        // 3. Merge identical rules.
+        if (dedupe_rules(&rules[nt]) != 0)
+        {
+            fprintf(stderr, "out of memory normalising grammar\n");
+            goto cleanup;
+        }
+    }
+
+    // 4. Find the non-terminals reachable from the start symbol, numbering
+    // them in the order they are discovered so that the start symbol is 0.
+    for (size_t nt = 0; nt < num_nt; nt++)
+    {
+        new_index[nt] = -1;
+    }
+
+    size_t num_new_nt = 0;
+    size_t num_new_rules = 0;
+    size_t num_new_tokens = 0;
+    work[num_new_nt] = start_index;
+    new_index[start_index] = num_new_nt++;
+
+    for (size_t w = 0; w < num_new_nt; w++)
+    {
+        RuleList* list = &rules[work[w]];
+        num_new_rules += list->count;
+        for (size_t r = 0; r < list->count; r++)
+        {
+            num_new_tokens += list->rules[r].num_tokens;
+            for (size_t i = 0; i < list->rules[r].num_tokens; i++)
+            {
+                int nt_index = is_non_terminal(list->rules[r].tokens[i]);
+                if (nt_index != -1 && new_index[nt_index] == -1)
+                {
+                    new_index[nt_index] = num_new_nt;
+                    work[num_new_nt++] = nt_index;
+                }
+            }
+        }
+    }
+
+    // Write out the normalised grammar in CSR form.
+    ng->original_keys = malloc(num_new_nt * sizeof(Token));
+    ng->rule_offsets = malloc((num_new_nt + 1) * sizeof(uint32_t));
+    ng->token_offsets = malloc((num_new_rules + 1) * sizeof(uint32_t));
+    ng->tokens = malloc((num_new_tokens ? num_new_tokens : 1) * sizeof(Token));
+    if (ng->original_keys == NULL || ng->rule_offsets == NULL
+        || ng->token_offsets == NULL || ng->tokens == NULL)
+    {
+        fprintf(stderr, "out of memory normalising grammar\n");
+        breakdown_normalised_grammar(ng);
+        goto cleanup;
+    }
+
+    size_t rule_pos = 0;
+    size_t token_pos = 0;
+    ng->token_offsets[0] = 0;
+    for (size_t nt = 0; nt < num_new_nt; nt++)
+    {
+        RuleList* list = &rules[work[nt]];
+        ng->original_keys[nt] = NON_TERMINAL(work[nt]);
+        ng->rule_offsets[nt] = rule_pos;
+
+        for (size_t r = 0; r < list->count; r++)
+        {
+            Rule rule = list->rules[r];
+            for (size_t i = 0; i < rule.num_tokens; i++)
+            {
+                int nt_index = is_non_terminal(rule.tokens[i]);
+                ng->tokens[token_pos++] = nt_index == -1
+                    ? rule.tokens[i]
+                    : NON_TERMINAL(new_index[nt_index]);
+            }
+            ng->token_offsets[++rule_pos] = token_pos;
+        }
+    }
+    ng->rule_offsets[num_new_nt] = rule_pos;
+
+    ng->grammar = (Grammar) {
+        num_new_nt,
+        num_new_rules,
+        num_new_tokens,
+        ng->rule_offsets,
+        ng->token_offsets,
+        ng->tokens
+    };
+    ret = 0;
+
+cleanup:
+    if (rules != NULL)
+    {
+        for (size_t nt = 0; nt < num_nt; nt++)
+        {
+            free(rules[nt].rules);
+        }
+    }
+    free(rules);
+    free(new_index);
+    free(work);
+    free(visited);
+    free(productive);
+    return ret;
+}
+
+void breakdown_normalised_grammar(NormalisedGrammar* ng)
+{
+    free(ng->original_keys);
+    free(ng->rule_offsets);
+    free(ng->token_offsets);
+    free(ng->tokens);
+    memset(ng, 0, sizeof(NormalisedGrammar));
+}
+
+Token original_token(const NormalisedGrammar* ng, Token key)
+{
+    int nt_index;
+    if ((nt_index = is_non_terminal(key)) != -1)
+        return ng->original_keys[nt_index];
+    return key;
+}
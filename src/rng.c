@@ -0,0 +1,54 @@
+#include "../include/rng.h"
+
+// One step of SplitMix64, used to expand a seed into the generator state.
+static uint64_t splitmix64(uint64_t* x)
+{
+    uint64_t z = (*x += 0x9e3779b97f4a7c15);
+    z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9;
+    z = (z ^ (z >> 27)) * 0x94d049bb133111eb;
+    return z ^ (z >> 31);
+}
+
+void rng_seed(Rng* rng, uint64_t seed)
+{
+    // SplitMix64 never outputs four zeros in a row, so the state is valid.
+    for (int i = 0; i < 4; i++)
+    {
+        rng->s[i] = splitmix64(&seed);
+    }
+}
+
+void rng_jump(Rng* rng)
+{
+    static const uint64_t JUMP[] = {
+        0x180ec6d33cfd0aba, 0xd5a61266f0c9392c,
+        0xa9582618e03fc9aa, 0x39abdc4529b1661c
+    };
+
+    uint64_t s[4] = {0, 0, 0, 0};
+    for (int i = 0; i < 4; i++)
+    {
+        for (int b = 0; b < 64; b++)
+        {
+            if (JUMP[i] & ((uint64_t) 1 << b))
+            {
+                s[0] ^= rng->s[0];
+                s[1] ^= rng->s[1];
+                s[2] ^= rng->s[2];
+                s[3] ^= rng->s[3];
+            }
+            rng_next(rng);
+        }
+    }
+
+    for (int i = 0; i < 4; i++)
+    {
+        rng->s[i] = s[i];
+    }
+}
+
+void rng_split(Rng* parent, Rng* child)
+{
+    *child = *parent;
+    rng_jump(parent);
+}
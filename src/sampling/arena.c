@@ -0,0 +1,83 @@
+#include "../../include/sampling/arena.h"
+
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+void init_arena(Arena* arena, size_t chunk_size)
+{
+    memset(arena, 0, sizeof(Arena));
+    arena->chunk_size = chunk_size ? chunk_size : ARENA_DEFAULT_CHUNK_SIZE;
+}
+
+void breakdown_arena(Arena* arena)
+{
+    ArenaChunk* chunk = arena->first;
+    while (chunk != NULL)
+    {
+        ArenaChunk* next = chunk->next;
+        free(chunk);
+        chunk = next;
+    }
+    memset(arena, 0, sizeof(Arena));
+}
+
+void reset_arena(Arena* arena)
+{
+    // Later chunks are emptied as they are reached again.
+    arena->current = arena->first;
+    if (arena->current != NULL)
+        arena->current->used = 0;
+    arena->allocated = 0;
+}
+
+// Moves on to a chunk with room for `size` bytes: the next chunk if it is
+// large enough, otherwise a new one placed before it.
+static ArenaChunk* next_chunk(Arena* arena, size_t size)
+{
+    ArenaChunk* current = arena->current;
+    ArenaChunk* next = current != NULL ? current->next : arena->first;
+    if (next != NULL && next->size >= size)
+    {
+        next->used = 0;
+        return next;
+    }
+
+    size_t chunk_size = size > arena->chunk_size ? size : arena->chunk_size;
+    if (chunk_size > SIZE_MAX - sizeof(ArenaChunk))
+        return NULL;
+    ArenaChunk* chunk = malloc(sizeof(ArenaChunk) + chunk_size);
+    if (chunk == NULL)
+        return NULL;
+    chunk->size = chunk_size;
+    chunk->used = 0;
+    chunk->next = next;
+    if (current != NULL)
+        current->next = chunk;
+    else
+        arena->first = chunk;
+    return chunk;
+}
+
+void* arena_alloc(Arena* arena, size_t size)
+{
+    // Round up so that the next allocation stays aligned. The chunk's data
+    // starts aligned for any type.
+    size_t align = _Alignof(max_align_t);
+    if (size > SIZE_MAX - align)
+        return NULL;
+    size = (size + align - 1) / align * align;
+
+    ArenaChunk* chunk = arena->current;
+    if (chunk == NULL || chunk->size - chunk->used < size)
+    {
+        if ((chunk = next_chunk(arena, size)) == NULL)
+            return NULL;
+        arena->current = chunk;
+    }
+
+    void* ptr = (char*) chunk->data + chunk->used;
+    chunk->used += size;
+    arena->allocated += size;
+    return ptr;
+}
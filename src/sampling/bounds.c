@@ -0,0 +1,190 @@
+#include "../../include/sampling/bounds.h"
+
+#include <string.h>
+
+// Adds two lengths, saturating at LENGTH_INF.
+static size_t add_lengths(size_t a, size_t b)
+{
+    if (a == LENGTH_INF || b == LENGTH_INF || a > LENGTH_INF - b)
+        return LENGTH_INF;
+    return a + b;
+}
+
+size_t key_min_length(const LengthBounds* lb, Token key)
+{
+    int nt_index;
+    if ((nt_index = is_non_terminal(key)) != -1)
+        return lb->key_min[nt_index];
+    return key < lb->num_terminals ? lb->terminal_length[key] : LENGTH_INF;
+}
+
+size_t key_max_length(const LengthBounds* lb, Token key)
+{
+    int nt_index;
+    if ((nt_index = is_non_terminal(key)) != -1)
+        return lb->key_max[nt_index];
+    return key < lb->num_terminals ? lb->terminal_length[key] : 0;
+}
+
+// Computes suffix_min for every token in the pool from the current key_min,
+// and returns 1 if any non-terminal's minimum decreased.
+static int relax_min(LengthBounds* lb)
+{
+    const Grammar* grammar = lb->grammar;
+    int changed = 0;
+
+    for (size_t nt = 0; nt < grammar->num_non_terminals; nt++)
+    {
+        size_t best = LENGTH_INF;
+        size_t first_rule = grammar_first_rule(grammar, nt);
+        for (size_t r = 0; r < grammar_num_rules(grammar, nt); r++)
+        {
+            size_t start = grammar->token_offsets[first_rule + r];
+            size_t end = grammar->token_offsets[first_rule + r + 1];
+
+            // Suffixes are built from the last token of the rule backwards.
+            size_t length = 0;
+            for (size_t pos = end; pos-- > start;)
+            {
+                length = add_lengths(length,
+                    key_min_length(lb, grammar->tokens[pos]));
+                lb->suffix_min[pos] = length;
+            }
+
+            if (length < best)
+                best = length;
+        }
+
+        if (best < lb->key_min[nt])
+        {
+            lb->key_min[nt] = best;
+            changed = 1;
+        }
+    }
+
+    return changed;
+}
+
+// Computes suffix_max for every token in the pool from the current key_max,
+// and marks each non-terminal whose maximum increased in `changed`. Rules
+// which cannot derive any string are ignored. Returns 1 if any maximum
+// increased.
+static int relax_max(LengthBounds* lb, uint8_t* changed)
+{
+    const Grammar* grammar = lb->grammar;
+    int any_changed = 0;
+
+    for (size_t nt = 0; nt < grammar->num_non_terminals; nt++)
+    {
+        changed[nt] = 0;
+        size_t best = 0;
+        size_t first_rule = grammar_first_rule(grammar, nt);
+        for (size_t r = 0; r < grammar_num_rules(grammar, nt); r++)
+        {
+            size_t start = grammar->token_offsets[first_rule + r];
+            size_t end = grammar->token_offsets[first_rule + r + 1];
+
+            size_t length = 0;
+            for (size_t pos = end; pos-- > start;)
+            {
+                if (lb->suffix_min[pos] == LENGTH_INF)
+                    length = 0;
+                else
+                    length = add_lengths(length,
+                        key_max_length(lb, grammar->tokens[pos]));
+                lb->suffix_max[pos] = length;
+            }
+
+            if (start < end && lb->suffix_min[start] != LENGTH_INF
+                && length > best)
+                best = length;
+        }
+
+        if (best > lb->key_max[nt])
+        {
+            lb->key_max[nt] = best;
+            changed[nt] = 1;
+            any_changed = 1;
+        }
+    }
+
+    return any_changed;
+}
+
+int init_length_bounds(LengthBounds* lb, const Grammar* grammar,
+    GrammarHashTable* table)
+{
+    memset(lb, 0, sizeof(LengthBounds));
+    lb->grammar = grammar;
+
+    // Terminal keys are dense from 0, so the largest one sizes the table.
+    for (size_t pos = 0; pos < grammar->num_tokens; pos++)
+    {
+        Token key = grammar->tokens[pos];
+        if (is_non_terminal(key) == -1 && (size_t) key + 1 > lb->num_terminals)
+            lb->num_terminals = (size_t) key + 1;
+    }
+
+    size_t num_nt = grammar->num_non_terminals;
+    size_t num_tokens = grammar->num_tokens;
+    lb->key_min = malloc((num_nt + 1) * sizeof(size_t));
+    lb->key_max = malloc((num_nt + 1) * sizeof(size_t));
+    lb->suffix_min = malloc((num_tokens + 1) * sizeof(size_t));
+    lb->suffix_max = malloc((num_tokens + 1) * sizeof(size_t));
+    lb->terminal_length = malloc((lb->num_terminals + 1) * sizeof(size_t));
+    uint8_t* changed = malloc(num_nt + 1);
+    if (lb->key_min == NULL || lb->key_max == NULL || lb->suffix_min == NULL
+        || lb->suffix_max == NULL || lb->terminal_length == NULL
+        || changed == NULL)
+    {
+        free(changed);
+        breakdown_length_bounds(lb);
+        return -1;
+    }
+
+    for (size_t key = 0; key < lb->num_terminals; key++)
+    {
+        GrammarHashTableVal* val = get_grammar(table, key);
+        lb->terminal_length[key] = val != NULL ? val->strlen : LENGTH_INF;
+    }
+
+    // Minimum lengths only ever decrease, and settle within one pass per
+    // non-terminal.
+    for (size_t nt = 0; nt < num_nt; nt++)
+    {
+        lb->key_min[nt] = LENGTH_INF;
+        lb->key_max[nt] = 0;
+    }
+    while (relax_min(lb))
+        ;
+
+    // Maximum lengths only ever increase. Any non-terminal with a finite
+    // maximum reaches it within `num_nt` passes, as a longest derivation
+    // never needs to repeat a non-terminal on a path from the root. So a
+    // maximum which still increases after that is unbounded.
+    size_t pass = 0;
+    while (relax_max(lb, changed))
+    {
+        if (++pass > num_nt)
+        {
+            for (size_t nt = 0; nt < num_nt; nt++)
+            {
+                if (changed[nt])
+                    lb->key_max[nt] = LENGTH_INF;
+            }
+        }
+    }
+
+    free(changed);
+    return 0;
+}
+
+void breakdown_length_bounds(LengthBounds* lb)
+{
+    free(lb->key_min);
+    free(lb->key_max);
+    free(lb->suffix_min);
+    free(lb->suffix_max);
+    free(lb->terminal_length);
+    memset(lb, 0, sizeof(LengthBounds));
+}
@@ -0,0 +1,363 @@
+#include "../../include/sampling/dense.h"
+#include "../../include/sampling/helpers.h"
+
+#include <string.h>
+
+// Marks an unranking step which derives a single symbol rather than a suffix.
+#define STEP_SYMBOL SIZE_MAX
+
+// One step of unranking: derivation `index` of length `length`, either from
+// `key` or from the suffix at `pos` of a rule ending at `end`.
+typedef struct UnrankStep
+{
+    Token key;
+    size_t pos;
+    size_t end;
+    size_t length;
+    uint64_t index;
+} UnrankStep;
+
+static uint64_t symbol_count(const CountTable* ct, Token key, size_t length)
+{
+    int nt_index;
+    if ((nt_index = is_non_terminal(key)) != -1)
+        return ct->key_counts[nt_index * ct->stride + length];
+    return key < ct->bounds.num_terminals && ct->bounds.terminal_length[key] == length;
+}
+
+// The suffix past the last token of a rule derives only the empty string.
+static uint64_t suffix_count(const CountTable* ct, size_t pos, size_t end,
+    size_t length)
+{
+    if (pos == end)
+        return length == 0;
+    return ct->suffix_counts[pos * ct->stride + length];
+}
+
+static size_t suffix_min_length(const CountTable* ct, size_t pos, size_t end)
+{
+    return pos == end ? 0 : ct->bounds.suffix_min[pos];
+}
+
+// Adds `a * b` to `*sum`, returning -1 if the result does not fit.
+static int add_product(uint64_t* sum, uint64_t a, uint64_t b)
+{
+    if (a != 0 && b > UINT64_MAX / a)
+        return -1;
+    if (*sum > UINT64_MAX - a * b)
+        return -1;
+    *sum += a * b;
+    return 0;
+}
+
+// Sets `lo` and `hi` to the lengths `head` can derive which fit in `length`.
+static void head_lengths(const CountTable* ct, Token head, size_t length,
+    size_t* lo, size_t* hi)
+{
+    size_t max = key_max_length(&ct->bounds, head);
+    *lo = key_min_length(&ct->bounds, head);
+    *hi = max < length ? max : length;
+}
+
+// Counts the derivations of `length` from the suffix at `pos` of a rule
+// ending at `end`, splitting the length between its head and the rest.
+static int fill_suffix(CountTable* ct, size_t pos, size_t end, size_t length)
+{
+    Token head = ct->grammar->tokens[pos];
+    size_t lo, hi;
+    head_lengths(ct, head, length, &lo, &hi);
+
+    uint64_t sum = 0;
+    for (size_t k = lo; k <= hi; k++)
+    {
+        if (add_product(&sum, symbol_count(ct, head, k),
+                suffix_count(ct, pos + 1, end, length - k)) != 0)
+            return -1;
+    }
+    ct->suffix_counts[pos * ct->stride + length] = sum;
+    return 0;
+}
+
+// Orders the non-terminals so that each comes after every non-terminal its
+// count of a length needs the count of the same length of, i.e., one which
+// may take up the whole string because the rest of the rule can be empty.
+// Also marks in `early` the positions whose rule prefix can be empty, whose
+// suffixes are needed while counting their non-terminal. Returns -1 if the
+// order has a cycle.
+static int order_non_terminals(const CountTable* ct, size_t* order, uint8_t* early)
+{
+    const Grammar* grammar = ct->grammar;
+    size_t num_nt = grammar->num_non_terminals;
+    uint8_t* done = calloc(num_nt + 1, 1);
+    if (done == NULL)
+        return -1;
+
+    size_t num_done = 0;
+    int progress = 1;
+    while (num_done < num_nt && progress)
+    {
+        progress = 0;
+        for (size_t nt = 0; nt < num_nt; nt++)
+        {
+            if (done[nt])
+                continue;
+
+            int ready = 1;
+            for (size_t r = grammar->rule_offsets[nt]; r < grammar->rule_offsets[nt + 1]; r++)
+            {
+                size_t start = grammar->token_offsets[r];
+                size_t end = grammar->token_offsets[r + 1];
+                int prefix_empty = 1;
+                for (size_t pos = start; pos < end; pos++)
+                {
+                    Token head = grammar->tokens[pos];
+                    int head_index = is_non_terminal(head);
+                    early[pos] = prefix_empty;
+                    if (prefix_empty && head_index != -1 && !done[head_index]
+                        && suffix_min_length(ct, pos + 1, end) == 0
+                        && ct->bounds.key_min[head_index] != LENGTH_INF)
+                        ready = 0;
+                    prefix_empty = prefix_empty && key_min_length(&ct->bounds, head) == 0;
+                }
+            }
+
+            // Non-terminals which derive nothing are never waited on.
+            if (ready || ct->bounds.key_min[nt] == LENGTH_INF)
+            {
+                done[nt] = 1;
+                order[num_done++] = nt;
+                progress = 1;
+            }
+        }
+    }
+
+    free(done);
+    return num_done == num_nt ? 0 : -1;
+}
+
+void breakdown_count_table(CountTable* ct)
+{
+    free(ct->key_counts);
+    free(ct->suffix_counts);
+    breakdown_length_bounds(&ct->bounds);
+    memset(ct, 0, sizeof(CountTable));
+}
+
+int init_count_table(CountTable* ct, const Grammar* grammar,
+    GrammarHashTable* table, size_t max_length)
+{
+    memset(ct, 0, sizeof(CountTable));
+    ct->grammar = grammar;
+    ct->max_length = max_length;
+    ct->stride = max_length + 1;
+
+    size_t num_nt = grammar->num_non_terminals;
+    size_t num_tokens = grammar->num_tokens;
+    if (ct->stride == 0 || ct->stride > SIZE_MAX / sizeof(uint64_t) / (num_tokens + num_nt + 1))
+        return -1;
+    if (init_length_bounds(&ct->bounds, grammar, table) != 0)
+        return -1;
+
+    ct->key_counts = calloc((num_nt + 1) * ct->stride, sizeof(uint64_t));
+    ct->suffix_counts = calloc((num_tokens + 1) * ct->stride, sizeof(uint64_t));
+    size_t* order = malloc((num_nt + 1) * sizeof(size_t));
+    uint8_t* early = malloc(num_tokens + 1);
+    if (ct->key_counts == NULL || ct->suffix_counts == NULL || order == NULL
+        || early == NULL)
+        goto fail;
+
+    if (order_non_terminals(ct, order, early) != 0)
+    {
+        fprintf(stderr, "The grammar has a cycle of rules which do not change "
+            "the length of a string, so it cannot be counted\n");
+        goto fail;
+    }
+
+    for (size_t length = 0; length <= max_length; length++)
+    {
+        // Each non-terminal needs the suffixes of its rules which can take up
+        // the whole string, and they need only counts which are done.
+        for (size_t i = 0; i < num_nt; i++)
+        {
+            size_t nt = order[i];
+            uint64_t count = 0;
+            for (size_t r = grammar->rule_offsets[nt]; r < grammar->rule_offsets[nt + 1]; r++)
+            {
+                size_t start = grammar->token_offsets[r];
+                size_t end = grammar->token_offsets[r + 1];
+                for (size_t pos = end; pos-- > start;)
+                {
+                    if (early[pos] && fill_suffix(ct, pos, end, length) != 0)
+                        goto overflow;
+                }
+                if (add_product(&count, 1, suffix_count(ct, start, end, length)) != 0)
+                    goto overflow;
+            }
+            ct->key_counts[nt * ct->stride + length] = count;
+        }
+
+        // The other suffixes need every count of this length.
+        for (size_t r = 0; r < grammar->num_rules; r++)
+        {
+            size_t start = grammar->token_offsets[r];
+            size_t end = grammar->token_offsets[r + 1];
+            for (size_t pos = end; pos-- > start;)
+            {
+                if (!early[pos] && fill_suffix(ct, pos, end, length) != 0)
+                    goto overflow;
+            }
+        }
+    }
+
+    free(order);
+    free(early);
+    return 0;
+
+overflow:
+    fprintf(stderr, "Too many strings to count up to length %zu in 64 bits\n",
+        max_length);
+fail:
+    free(order);
+    free(early);
+    breakdown_count_table(ct);
+    return -1;
+}
+
+uint64_t count_table_count(const CountTable* ct, Token key, size_t l_str)
+{
+    if (l_str > ct->max_length)
+        return 0;
+    return symbol_count(ct, key, l_str);
+}
+
+// Pushes a step onto a growable stack.
+static int push_step(UnrankStep** steps, size_t* num_steps, size_t* capacity,
+    UnrankStep step)
+{
+    if (*num_steps == *capacity)
+    {
+        size_t new_capacity = *capacity ? *capacity * 2 : 64;
+        UnrankStep* new_steps = realloc(*steps, new_capacity * sizeof(UnrankStep));
+        if (new_steps == NULL)
+            return -1;
+        *steps = new_steps;
+        *capacity = new_capacity;
+    }
+    (*steps)[(*num_steps)++] = step;
+    return 0;
+}
+
+static int append_token(DynTokenArray* dta, size_t* capacity, Token key)
+{
+    if (dta->length == *capacity)
+    {
+        size_t new_capacity = *capacity ? *capacity * 2 : 16;
+        Token* list = realloc(dta->list, new_capacity * sizeof(Token));
+        if (list == NULL)
+            return -1;
+        dta->list = list;
+        *capacity = new_capacity;
+    }
+    dta->list[dta->length++] = key;
+    return 0;
+}
+
+// Replaces the step on top of the stack, which derives a non-terminal, with
+// the suffix of the rule its index falls in.
+static int unrank_symbol(const CountTable* ct, UnrankStep step,
+    UnrankStep** steps, size_t* num_steps, size_t* capacity)
+{
+    const Grammar* grammar = ct->grammar;
+    size_t nt = is_non_terminal(step.key);
+    for (size_t r = grammar->rule_offsets[nt]; r < grammar->rule_offsets[nt + 1]; r++)
+    {
+        size_t start = grammar->token_offsets[r];
+        size_t end = grammar->token_offsets[r + 1];
+        uint64_t count = suffix_count(ct, start, end, step.length);
+        if (step.index < count)
+        {
+            if (start == end)
+                return 0;
+            UnrankStep suffix = {0, start, end, step.length, step.index};
+            return push_step(steps, num_steps, capacity, suffix);
+        }
+        step.index -= count;
+    }
+    return -1;
+}
+
+// Replaces the step on top of the stack, which derives a suffix, with its
+// head and the rest of the suffix.
+static int unrank_suffix(const CountTable* ct, UnrankStep step,
+    UnrankStep** steps, size_t* num_steps, size_t* capacity)
+{
+    Token head = ct->grammar->tokens[step.pos];
+    size_t lo, hi;
+    head_lengths(ct, head, step.length, &lo, &hi);
+    for (size_t k = lo; k <= hi; k++)
+    {
+        uint64_t rest = suffix_count(ct, step.pos + 1, step.end, step.length - k);
+        uint64_t block = symbol_count(ct, head, k) * rest;
+        if (step.index < block)
+        {
+            // The rest is pushed first so that the head is derived first.
+            UnrankStep tail = {0, step.pos + 1, step.end, step.length - k, step.index % rest};
+            UnrankStep symbol = {head, STEP_SYMBOL, 0, k, step.index / rest};
+            if (step.pos + 1 < step.end
+                && push_step(steps, num_steps, capacity, tail) != 0)
+                return -1;
+            return push_step(steps, num_steps, capacity, symbol);
+        }
+        step.index -= block;
+    }
+    return -1;
+}
+
+DynTokenArray* count_table_string_at(const CountTable* ct, Token key,
+    size_t l_str, uint64_t at)
+{
+    if (at >= count_table_count(ct, key, l_str))
+    {
+        printf("`at` should be < the number of strings\n");
+        return NULL;
+    }
+
+    DynTokenArray* dta = malloc(sizeof(DynTokenArray));
+    if (dta == NULL)
+        return NULL;
+    *dta = (DynTokenArray) {NULL, 0, NULL};
+    size_t dta_capacity = 0;
+
+    UnrankStep* steps = NULL;
+    size_t num_steps = 0, capacity = 0;
+    UnrankStep first = {key, STEP_SYMBOL, 0, l_str, at};
+    int ret = push_step(&steps, &num_steps, &capacity, first);
+    while (ret == 0 && num_steps > 0)
+    {
+        UnrankStep step = steps[--num_steps];
+        if (step.pos != STEP_SYMBOL)
+            ret = unrank_suffix(ct, step, &steps, &num_steps, &capacity);
+        else if (is_non_terminal(step.key) != -1)
+            ret = unrank_symbol(ct, step, &steps, &num_steps, &capacity);
+        else
+            ret = append_token(dta, &dta_capacity, step.key);
+    }
+
+    free(steps);
+    if (ret != 0)
+    {
+        free(dta->list);
+        free(dta);
+        return NULL;
+    }
+    return dta;
+}
+
+DynTokenArray* count_table_sample_UAR(const CountTable* ct, Token key,
+    size_t l_str, Rng* rng)
+{
+    uint64_t count = count_table_count(ct, key, l_str);
+    if (count == 0)
+        return NULL;
+    return count_table_string_at(ct, key, l_str, rng_bounded64(rng, count));
+}
@@ -1,137 +1,158 @@
 #include "../../include/sampling/sampling.h"
 #include "../../include/sampling/helpers.h"
 
-int hash(Token key)
+uint64_t hash(Token key)
 {
-    // Jenkins one-at-a-time hash
-    uint32_t hash = 0;
-
-    for (size_t i = 0; i < 8; ++i) {
-        hash += key & 1;
-        hash += (hash << 10);
-        hash ^= (hash >> 6);
-        key >>= 1;
-    }
-
-    hash += (hash << 3);
-    hash ^= (hash >> 11);
-    hash += (hash << 15);
-
-    return hash % GRAMMAR_TABLE_SIZE;
+    return mix_hash(key);
 }
 
 void print_grammar_hash_table(GrammarHashTable* table)
 {
     printf("----------- GRAMMAR HASH TABLE -------------\n");
-    for (size_t i = 0; i < GRAMMAR_TABLE_SIZE; i++)
+    for (size_t i = 0; i < table->capacity; i++)
     {
-        if ((*table)[i] == NULL)
+        if (table->slots[i].val == NULL)
         {
             printf("\t%zu\t---\n", i);
         }
         else
         {
-            printf("\t%zu\t", i);
-            GrammarHashTableVal* tmp = (*table)[i];
-            while (tmp != NULL) {
-                printf("%s -> ", tmp->str);
-                tmp = tmp->next;
-            }
-            printf("\n");
+            printf("\t%zu\t%s\n", i, table->slots[i].val->str);
         }
     }
     printf("-----------------------------------------\n");
 }
 
+// Returns the index of the slot holding `key`, or of the empty slot where it
+// belongs.
+static size_t find_grammar_slot(GrammarHashTableSlot* slots, size_t capacity, 
+    Token key)
+{
+    size_t mask = capacity - 1;
+    size_t index = hash(key) & mask;
+    while (slots[index].val != NULL && slots[index].key != key)
+    {
+        index = (index + 1) & mask;
+    }
+    return index;
+}
+
+// Moves every entry into a new array of `capacity` slots.
+static int resize_grammar_hash_table(GrammarHashTable* table, size_t capacity)
+{
+    GrammarHashTableSlot* slots = calloc(capacity, sizeof(GrammarHashTableSlot));
+    if (slots == NULL)
+        return -1;
+
+    for (size_t i = 0; i < table->capacity; i++)
+    {
+        GrammarHashTableSlot* old = &table->slots[i];
+        if (old->val != NULL)
+            slots[find_grammar_slot(slots, capacity, old->key)] = *old;
+    }
+
+    free(table->slots);
+    table->slots = slots;
+    table->capacity = capacity;
+    return 0;
+}
+
 int insert_grammar(GrammarHashTable* table, GrammarHashTableVal* ts)
 {
     if (ts == NULL) return -1;
-    int index = hash(ts->key);
 
-    // Replace the current start of the linked-list with p.
-    ts->next = (*table)[index];
-    (*table)[index] = ts;
+    if (table->count + 1 > table->capacity * HASH_TABLE_MAX_LOAD)
+    {
+        size_t capacity = table->capacity ? table->capacity * 2 : HASH_TABLE_MIN_CAPACITY;
+        if (resize_grammar_hash_table(table, capacity) != 0)
+            return -1;
+    }
+
+    // A new value for the same key replaces the old one.
+    GrammarHashTableSlot* slot = 
+        &table->slots[find_grammar_slot(table->slots, table->capacity, ts->key)];
+    if (slot->val == NULL)
+        table->count++;
+    else
+        free_token_str(slot->val);
+    *slot = (GrammarHashTableSlot) {ts->key, ts};
 
     return 0;
 }
 
 GrammarHashTableVal* get_grammar(GrammarHashTable* table, Token key)
 {
-    int index = hash(key);
-    GrammarHashTableVal* tmp = (*table)[index];
-    while (tmp != NULL && tmp->key != key)
-    {
-        tmp = tmp->next;
-    }
-    return tmp;
+    if (table->count == 0)
+        return NULL;
+    return table->slots[find_grammar_slot(table->slots, table->capacity, key)].val;
 }
 
 GrammarHashTableVal* delete_grammar(GrammarHashTable* table, Token key)
 {
-    int index = hash(key);
-    
-    GrammarHashTableVal* tmp = (*table)[index];
-    GrammarHashTableVal* prev = NULL;
-    while (tmp != NULL && tmp->key != key)
-    {
-        prev = tmp;
-        tmp = tmp->next;
-    }
-
-    if (tmp == NULL) return NULL; // No match found.
-
-    if (prev == NULL)
+    if (table->count == 0) return NULL;
+
+    size_t mask = table->capacity - 1;
+    size_t index = find_grammar_slot(table->slots, table->capacity, key);
+    GrammarHashTableVal* val = table->slots[index].val;
+    if (val == NULL) return NULL; // No match found.
+
+    // Shift back every later entry of the run which may no longer be reached
+    // past the hole, so that no tombstone is needed.
+    size_t hole = index;
+    for (size_t next = (hole + 1) & mask; table->slots[next].val != NULL; 
+        next = (next + 1) & mask)
     {
-        // The node to delete was the head of the linked-list.
-        (*table)[index] = tmp->next;
-    }
-    else
-    {
-        prev->next = tmp->next;
+        size_t home = hash(table->slots[next].key) & mask;
+        if (((next - home) & mask) >= ((next - hole) & mask))
+        {
+            table->slots[hole] = table->slots[next];
+            hole = next;
+        }
     }
+    table->slots[hole] = (GrammarHashTableSlot) {0, NULL};
+    table->count--;
 
-    return tmp;
+    return val;
 }
 
 void free_token_str(GrammarHashTableVal *token_str) 
 {
-    while (token_str != NULL) {
-        GrammarHashTableVal *next = token_str->next;
-        free(token_str->str);
-        free(token_str);
-        token_str = next;
-    }
+    if (token_str == NULL) return;
+    free(token_str->str);
+    free(token_str);
 }
 
 void breakdown_grammar_hash_table(GrammarHashTable* table)
 {
-    for (size_t i = 0; i < GRAMMAR_TABLE_SIZE; i++) {
-        free_token_str((*table)[i]);
+    for (size_t i = 0; i < table->capacity; i++) {
+        free_token_str(table->slots[i].val);
     }
+    free(table->slots);
+    table->slots = NULL;
+    table->capacity = 0;
+    table->count = 0;
 }
 
 void insert_token_str(GrammarHashTable* table, Token key, 
     char* str, int strlen) 
 {
     GrammarHashTableVal* ts = malloc(sizeof(GrammarHashTableVal));
-    *ts = (GrammarHashTableVal) {key, strdup(str), strlen, NULL};
-    insert_grammar(table, ts);
+    *ts = (GrammarHashTableVal) {key, strdup(str), strlen};
+    if (insert_grammar(table, ts) != 0)
+        free_token_str(ts);
 }
 
 void init_grammar_hash_table(GrammarHashTable* table)
 {
-    // Set entire table to be empty.
-    for (size_t i = 0; i < GRAMMAR_TABLE_SIZE; i++)
-    {
-        (*table)[i] = NULL;
-    } 
-
-    insert_token_str(table, 0x80, "<start>", LENGTH_NA);
-    insert_token_str(table, 0x81, "<sentence>", LENGTH_NA);
-    insert_token_str(table, 0x82, "<noun_phrase>", LENGTH_NA);
-    insert_token_str(table, 0x83, "<verb>", LENGTH_NA);
-    insert_token_str(table, 0x84, "<article>", LENGTH_NA);
-    insert_token_str(table, 0x85, "<noun>", LENGTH_NA);
+    // The slots are allocated on the first insert.
+    *table = (GrammarHashTable) {NULL, 0, 0};
+
+    insert_token_str(table, NON_TERMINAL(0), "<start>", LENGTH_NA);
+    insert_token_str(table, NON_TERMINAL(1), "<sentence>", LENGTH_NA);
+    insert_token_str(table, NON_TERMINAL(2), "<noun_phrase>", LENGTH_NA);
+    insert_token_str(table, NON_TERMINAL(3), "<verb>", LENGTH_NA);
+    insert_token_str(table, NON_TERMINAL(4), "<article>", LENGTH_NA);
+    insert_token_str(table, NON_TERMINAL(5), "<noun>", LENGTH_NA);
     insert_token_str(table, 0x00, "horse", 5);
     insert_token_str(table, 0x01, "dog", 3);
     insert_token_str(table, 0x02, "hamster", 7);
@@ -141,3 +162,24 @@ void init_grammar_hash_table(GrammarHashTable* table)
     insert_token_str(table, 0x06, "walks", 5);
     insert_token_str(table, 0x07, "jumps", 5);
 }
+
+void init_grammar_hash_table_from_file(GrammarHashTable* table, 
+    const GrammarFile* gf)
+{
+    // The slots are allocated on the first insert.
+    *table = (GrammarHashTable) {NULL, 0, 0};
+
+    for (size_t i = 0; i < gf->grammar.num_non_terminals; i++)
+    {
+        Token key = NON_TERMINAL(i);
+        insert_token_str(table, key, 
+            (char*) grammar_file_token_str(gf, key), LENGTH_NA);
+    }
+
+    for (size_t i = 0; i < gf->num_terminals; i++)
+    {
+        Token key = i;
+        insert_token_str(table, key, 
+            (char*) grammar_file_token_str(gf, key), gf->terminal_lengths[i]);
+    }
+}
@@ -1,21 +1,25 @@
 #include "../../include/sampling/helpers.h"
 
-KeyNode* create_key_node(Token key, size_t l_str, int count, RuleNode* rules)
+KeyNode* create_key_node(Arena* arena, Token key, size_t l_str, int count, 
+    RuleNode* rules)
 {
-    KeyNode* kn = malloc(sizeof(KeyNode));
+    KeyNode* kn = arena_alloc(arena, sizeof(KeyNode));
+    if (kn == NULL)
+        return NULL;
     kn->token = key;
     kn->l_str = l_str;
     kn->count = count;
     kn->rules = rules;
-    kn->next = NULL;
 
     return kn;
 }
 
-RuleNode* create_rule_node(KeyNode* key, RuleNode* tail, 
+RuleNode* create_rule_node(Arena* arena, KeyNode* key, RuleNode* tail, 
                             size_t l_str, int count)
 {
-    RuleNode* rn = malloc(sizeof(RuleNode));
+    RuleNode* rn = arena_alloc(arena, sizeof(RuleNode));
+    if (rn == NULL)
+        return NULL;
     rn->key = key;
     rn->tail = tail;
     rn->l_str = l_str;
@@ -129,27 +133,6 @@ void free_token_array(DynTokenArray* arr)
     free(arr);
 }
 
-void free_key_node(KeyNode* kn) 
-{
-    KeyNode* current = kn;
-    while (current != NULL) {
-        KeyNode* next = current->next;
-        free(current);
-        current = next;
-    }
-}
-
-void free_rule_node(RuleHashTableVal* val) 
-{
-    RuleHashTableVal* current = val;
-    while (current != NULL) {
-        RuleHashTableVal* next = current->next;
-        free(current->list);
-        free(current);
-        current = next;
-    }
-}
-
 void print_dta(DynTokenArray* dta)
 {
     if (dta == NULL)
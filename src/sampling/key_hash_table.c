@@ -1,81 +1,106 @@
 #include "../../include/sampling/sampling.h"
 #include "../../include/sampling/helpers.h"
 
-int hash_key(Token key, size_t l_str)
+uint64_t hash_key(Token key, size_t l_str)
 {
-    uint32_t hash = 17;
-
     // Combine the key and l_str into the hash
-    hash = (hash << 5) ^ key ^ (uint32_t)l_str;
-
-    return hash % KEY_TABLE_SIZE;
+    return mix_hash(((uint64_t) key << 32) ^ (uint64_t) l_str);
 }
 
 void init_key_hash_table(KeyHashTable* table)
 {
-    // Set entire table to be empty.
-    for (size_t i = 0; i < KEY_TABLE_SIZE; i++)
-    {
-        (*table)[i] = NULL;
-    } 
+    // The slots are allocated on the first insert.
+    table->slots = NULL;
+    table->capacity = 0;
+    table->count = 0;
 }
 
 void print_key_hash_table(KeyHashTable* table)
 {
     printf("------------ KEY HASH TABLE -------------\n");
-    for (size_t i = 0; i < KEY_TABLE_SIZE; i++)
+    for (size_t i = 0; i < table->capacity; i++)
     {
-        if ((*table)[i] == NULL)
+        KeyNode* tmp = table->slots[i].node;
+        if (tmp == NULL)
         {
             printf("\t%zu\t---\n", i);
         }
+        else if (tmp->token == EMPTY_TOKEN)
+        {
+            printf("\t%zu\tEMPTY_KEY\n", i);
+        }
         else
         {
-            printf("\t%zu\t", i);
-            KeyNode* tmp = (*table)[i];
-            while (tmp != NULL) {
-                if (tmp->token == EMPTY_TOKEN) {
-                    printf("EMPTY_KEY -> ");
-                } else {
-                    if (tmp->count != 0)
-                    printf("(0x%x, l: %lu, c: %d) -> ", tmp->token, tmp->l_str, tmp->count);
-                }
-                tmp = tmp->next;
-            }
-            printf("\n");
+            printf("\t%zu\t(0x%x, l: %lu, c: %d)\n", i, tmp->token, tmp->l_str, tmp->count);
         }
     }
     printf("-------------------------------------------\n");
 }
 
+// Returns the slot holding (key, l_str), or the empty slot where it belongs.
+static KeyHashTableSlot* find_key_slot(KeyHashTableSlot* slots, size_t capacity, 
+    Token key, size_t l_str)
+{
+    size_t mask = capacity - 1;
+    size_t index = hash_key(key, l_str) & mask;
+    while (slots[index].node != NULL
+        && (slots[index].key != key || slots[index].l_str != l_str))
+    {
+        index = (index + 1) & mask;
+    }
+    return &slots[index];
+}
+
+// Moves every entry into a new array of `capacity` slots.
+static int resize_key_hash_table(KeyHashTable* table, size_t capacity)
+{
+    KeyHashTableSlot* slots = calloc(capacity, sizeof(KeyHashTableSlot));
+    if (slots == NULL)
+        return -1;
+
+    for (size_t i = 0; i < table->capacity; i++)
+    {
+        KeyHashTableSlot* old = &table->slots[i];
+        if (old->node != NULL)
+            *find_key_slot(slots, capacity, old->key, old->l_str) = *old;
+    }
+
+    free(table->slots);
+    table->slots = slots;
+    table->capacity = capacity;
+    return 0;
+}
+
 void insert_key(KeyHashTable* table, Token key, size_t l_str, KeyNode* kn)
 {
     if (kn == NULL) return;
 
-    int index = hash_key(key, l_str);
+    if (table->count + 1 > table->capacity * HASH_TABLE_MAX_LOAD)
+    {
+        size_t capacity = table->capacity ? table->capacity * 2 : HASH_TABLE_MIN_CAPACITY;
+        if (resize_key_hash_table(table, capacity) != 0)
+            return;
+    }
 
-    // Replace the current start of the linked-list with kn.
-    kn->next = (*table)[index];
-    (*table)[index] = kn;
+    // A new KeyNode for the same (key, l_str) replaces the old one.
+    KeyHashTableSlot* slot = find_key_slot(table->slots, table->capacity, key, l_str);
+    if (slot->node == NULL)
+        table->count++;
+    *slot = (KeyHashTableSlot) {key, l_str, kn};
 }
 
 KeyNode* get_key(KeyHashTable* table, Token key, size_t l_str)
 {
-    int index = hash_key(key, l_str);
-    KeyNode* tmp = (*table)[index];
-    while (tmp != NULL && (tmp->token != key || tmp->l_str != l_str))
-    {
-        tmp = tmp->next;
-    }
-    return tmp;
+    if (table->count == 0)
+        return NULL;
+    return find_key_slot(table->slots, table->capacity, key, l_str)->node;
 }
 
 void breakdown_key_hash_table(KeyHashTable* table)
 {
-    for (size_t i = 0; i < KEY_TABLE_SIZE; i++)
-    {
-        free_key_node((*table)[i]);
-    }
+    // The KeyNodes belong to the arena they were created in.
+    free(table->slots);
+    init_key_hash_table(table);
 }
 
 void print_key_node(KeyNode* kn)
@@ -1,124 +1,106 @@
 #include "../../include/sampling/sampling.h"
 #include "../../include/sampling/helpers.h"
 
-int hash_rule(Rule* rule, size_t l_str)
+uint64_t hash_rule(size_t suffix, size_t l_str)
 {
-    uint32_t hash = 5382;
+    return mix_hash(((uint64_t) suffix << 32) ^ (uint64_t) l_str);
+}
+
+void init_rule_hash_table(RuleHashTable* table)
+{
+    // The slots are allocated on the first insert.
+    table->slots = NULL;
+    table->capacity = 0;
+    table->count = 0;
+}
 
-    for (size_t i = 0; i < rule->num_tokens; i++)
+void print_rule_hash_table(RuleHashTable* table)
+{
+    printf("------------ RULE HASH TABLE --------------\n");
+    for (size_t i = 0; i < table->capacity; i++)
     {
-        hash = ((hash << 5) + hash) ^ rule->tokens[i];
+        RuleHashTableVal* val = &table->slots[i];
+        if (val->list == NULL)
+        {
+            printf("\t%zu\t---\n", i);
+        }
+        else
+        {
+            printf("\t%zu\t(suffix: %zu, l: %zu) ", i, val->suffix, val->l_str);
+            for (RuleNode* tmp = val->list; tmp != NULL; tmp = tmp->next)
+            {
+                printf("(0x%x, l: %lu, c: %d) -> ", tmp->key->token, tmp->l_str, tmp->count);
+            }
+            printf("\n");
+        }
     }
-    hash = ((hash << 5) + hash) ^ (uint32_t)l_str;
-
-    return hash % RULE_TABLE_SIZE;
+    printf("--------------------------------------------\n");
 }
 
-void init_rule_hash_table(RuleHashTable* table)
+// Returns the slot holding (suffix, l_str), or the empty slot where it belongs.
+static RuleHashTableVal* find_rule_slot(RuleHashTableVal* slots, size_t capacity,
+    size_t suffix, size_t l_str)
 {
-    // Set entire table to be empty.
-    for (size_t i = 0; i < RULE_TABLE_SIZE; i++)
+    size_t mask = capacity - 1;
+    size_t index = hash_rule(suffix, l_str) & mask;
+    while (slots[index].list != NULL
+        && (slots[index].suffix != suffix || slots[index].l_str != l_str))
     {
-        (*table)[i] = NULL;
-    } 
+        index = (index + 1) & mask;
+    }
+    return &slots[index];
 }
 
-// void print_rule_hash_table(RuleHashTable* table)
-// {
-//     printf("------------ RULE HASH TABLE --------------\n");
-//     for (size_t i = 0; i < RULE_TABLE_SIZE; i++)
-//     {
-//         if ((*table)[i] == NULL)
-//         {
-//             printf("\t%zu\t---\n", i);
-//         }
-//         else
-//         {
-//             printf("\t%zu\t", i);
-//             RuleNode* tmp = (*table)[i];
-//             while (tmp != NULL) {
-//                 printf("(0x%x, l: %lu, c: %d, tail: [", tmp->key->token, tmp->l_str, tmp->count);
-                
-//                 // Print the tail linked list
-//                 RuleNode* tailNode = tmp->tail;
-//                 while (tailNode != NULL) {
-//                     printf("(0x%x, l: %lu, c: %d) -> ", tailNode->key->token, tailNode->l_str, tailNode->count);
-//                     tailNode = tailNode->next;
-//                 }
-                
-//                 printf("]) -> ");
-                
-//                 tmp = tmp->next;
-//             }
-//             printf("\n");
-//         }
-//     }
-//     printf("--------------------------------------------\n");
-// }
-
-void insert_rule(RuleHashTable* table, Rule* rule, size_t l_str, RuleNode* rn)
+// Moves every entry into a new array of `capacity` slots.
+static int resize_rule_hash_table(RuleHashTable* table, size_t capacity)
 {
-    if (rn == NULL) return;
+    RuleHashTableVal* slots = calloc(capacity, sizeof(RuleHashTableVal));
+    if (slots == NULL)
+        return -1;
 
-    int index = hash_rule(rule, l_str);
+    for (size_t i = 0; i < table->capacity; i++)
+    {
+        RuleHashTableVal* old = &table->slots[i];
+        if (old->list != NULL)
+            *find_rule_slot(slots, capacity, old->suffix, old->l_str) = *old;
+    }
 
-    RuleHashTableVal* new_val = malloc(sizeof(RuleHashTableVal));
-    new_val->list = rn;
-    new_val->l_str = l_str;
-    new_val->next = (*table)[index];
-    (*table)[index] = new_val;
+    free(table->slots);
+    table->slots = slots;
+    table->capacity = capacity;
+    return 0;
 }
 
-// Here tmp is the head of the linked list at a specific RuleHashTableVal.
-int rule_list_equals(RuleNode* head, Rule* rule) 
+void insert_rule(RuleHashTable* table, size_t suffix, size_t l_str, RuleNode* rn)
 {
-    RuleNode* ptr = head;
-    while (ptr != NULL)
-    {
-        // Check if head token is equal.
-        size_t head_index;
-        for (head_index = 0; head_index < rule->num_tokens; head_index++)
-        {
-            if (rule->tokens[head_index] != EMPTY_TOKEN)
-                break;
-        }
-        
-        if (rule->tokens[head_index] != ptr->key->token)
-            return 0;
-        
-        if (rule->tokens[head_index + 1] != ptr->tail->key->token)
-            return 0;
+    if (rn == NULL) return;
 
-        ptr = ptr->next;
+    if (table->count + 1 > table->capacity * HASH_TABLE_MAX_LOAD)
+    {
+        size_t capacity = table->capacity ? table->capacity * 2 : HASH_TABLE_MIN_CAPACITY;
+        if (resize_rule_hash_table(table, capacity) != 0)
+            return;
     }
 
-    return 1;
+    // A new list for the same (suffix, l_str) replaces the old one.
+    RuleHashTableVal* val = find_rule_slot(table->slots, table->capacity, suffix, l_str);
+    if (val->list == NULL)
+        table->count++;
+    *val = (RuleHashTableVal) {rn, suffix, l_str};
 }
 
-RuleNode* get_rule(RuleHashTable* table, Rule* rule, size_t l_str)
+RuleNode* get_rule(RuleHashTable* table, size_t suffix, size_t l_str)
 {
-    int index = hash_rule(rule, l_str);
-    
-    RuleHashTableVal* tmp = (*table)[index];
-    while (tmp != NULL) 
-    {
-        if (tmp->l_str == l_str) {
-            if (rule_list_equals(tmp->list, rule)) 
-            {
-                return tmp->list;
-            }
-        }
-        tmp = tmp->next;
-    }
-    return NULL;
+    if (table->count == 0)
+        return NULL;
+    return find_rule_slot(table->slots, table->capacity, suffix, l_str)->list;
 }
 
 void breakdown_rule_hash_table(RuleHashTable* table)
 {
-    for (size_t i = 0; i < RULE_TABLE_SIZE; i++)
-    {
-        free_rule_node((*table)[i]);
-    }
+    // The RuleNodes belong to the arena they were created in.
+    free(table->slots);
+    init_rule_hash_table(table);
 }
 
 void print_rule_node(RuleNode* rn)
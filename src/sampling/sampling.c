@@ -1,27 +1,96 @@
 #include "../../include/sampling/sampling.h"
 #include "../../include/sampling/helpers.h"
 
-KeyHashTable key_strs;
-RuleHashTable rule_strs;
-GrammarHashTable grammar_hash;
+int init_sampler_context(SamplerContext* ctx, const GrammarFile* gf)
+{
+    ctx->grammar = &gf->grammar;
+    init_grammar_hash_table_from_file(&ctx->grammar_hash, gf);
+    init_key_hash_table(&ctx->key_strs);
+    init_rule_hash_table(&ctx->rule_strs);
+    init_arena(&ctx->arena, 0);
+    ctx->failed = 0;
+    if (init_length_bounds(&ctx->length_bounds, ctx->grammar, &ctx->grammar_hash) != 0)
+    {
+        breakdown_grammar_hash_table(&ctx->grammar_hash);
+        return -1;
+    }
+    return 0;
+}
+
+void reset_sampler_context(SamplerContext* ctx)
+{
+    // The nodes belong to the arena, so the tables need only be emptied.
+    breakdown_key_hash_table(&ctx->key_strs);
+    breakdown_rule_hash_table(&ctx->rule_strs);
+    reset_arena(&ctx->arena);
+    ctx->failed = 0;
+}
+
+void breakdown_sampler_context(SamplerContext* ctx)
+{
+    breakdown_key_hash_table(&ctx->key_strs);
+    breakdown_rule_hash_table(&ctx->rule_strs);
+    breakdown_grammar_hash_table(&ctx->grammar_hash);
+    breakdown_length_bounds(&ctx->length_bounds);
+    breakdown_arena(&ctx->arena);
+}
+
+// Returns 1 if `rule` is a view into the token pool of `grammar`, in which
+// case `*pos` is set to the position of the rule's first token in the pool.
+// The position identifies the rule suffix for the memo and the bounds.
+static int rule_pool_pos(Rule* rule, const Grammar* grammar, size_t* pos)
+{
+    if (rule->tokens < grammar->tokens
+        || rule->tokens >= grammar->tokens + grammar->num_tokens)
+        return 0;
+
+    *pos = rule->tokens - grammar->tokens;
+    return 1;
+}
+
+// Records that the context's arena could not grow. Returns NULL so that it
+// can be returned straight away.
+static void* sampler_failed(SamplerContext* ctx)
+{
+    if (!ctx->failed)
+        fprintf(stderr, "Could not allocate memory for the sampling memo\n");
+    ctx->failed = 1;
+    return NULL;
+}
 
-KeyNode* key_get_def(Token key, Grammar* grammar, size_t l_str)
+KeyNode* key_get_def(SamplerContext* ctx, Token key, size_t l_str)
 {
-    if (get_key(&key_strs, key, l_str) != NULL)
-        return get_key(&key_strs, key, l_str);
+    if (ctx->failed)
+        return NULL;
+
+    const Grammar* grammar = ctx->grammar;
+    KeyNode* memoized_result;
+    if ((memoized_result = get_key(&ctx->key_strs, key, l_str)) != NULL)
+        return memoized_result;
     
-    size_t nt_index;
+    int nt_index;
     if ((nt_index = is_non_terminal(key)) != -1)
     {
+        // Skip the rules entirely if no string of this length is derivable.
+        if (l_str < ctx->length_bounds.key_min[nt_index]
+            || l_str > ctx->length_bounds.key_max[nt_index])
+        {
+            KeyNode* kn = create_key_node(&ctx->arena, key, l_str, 0, NULL);
+            if (kn == NULL)
+                return sampler_failed(ctx);
+            insert_key(&ctx->key_strs, key, l_str, kn);
+            return kn;
+        }
+
         RuleNode* s = NULL; 
         int count = 0;
-        for (size_t i = 0; i < grammar->non_terminals[nt_index].num_rules; i++) {
-            RuleNode* s_ = rules_get_def(
-                &grammar->non_terminals[nt_index].rules[i], 
-                grammar, 
-                l_str
-            );
+        size_t first_rule = grammar_first_rule(grammar, nt_index);
+        for (size_t i = 0; i < grammar_num_rules(grammar, nt_index); i++) {
+            Rule rule = grammar_rule(grammar, first_rule + i);
+            RuleNode* s_ = rules_get_def(ctx, &rule, l_str);
 
+            if (ctx->failed)
+                return NULL;
             if (s_ == NULL) 
                 continue;
 
@@ -46,80 +115,107 @@ KeyNode* key_get_def(Token key, Grammar* grammar, size_t l_str)
             }
         }
 
-        KeyNode* kn = create_key_node(key, l_str, count, s);
-        insert_key(&key_strs, key, l_str, kn);
+        KeyNode* kn = create_key_node(&ctx->arena, key, l_str, count, s);
+        if (kn == NULL)
+            return sampler_failed(ctx);
+        insert_key(&ctx->key_strs, key, l_str, kn);
         return kn;
     }
     else
     {
         // `key` is a terminal symbol.
-        if (l_str == get_grammar(&grammar_hash, key)->strlen)
+        if (l_str == get_grammar(&ctx->grammar_hash, key)->strlen)
         {
-            KeyNode* kn = create_key_node(key, l_str, 1, NULL);
-            insert_key(&key_strs, key, l_str, kn);
+            KeyNode* kn = create_key_node(&ctx->arena, key, l_str, 1, NULL);
+            if (kn == NULL)
+                return sampler_failed(ctx);
+            insert_key(&ctx->key_strs, key, l_str, kn);
             return kn;
         }
         else
         {
-            KeyNode* empty_key = create_key_node(EMPTY_TOKEN, 0, -1, NULL);
+            KeyNode* empty_key = create_key_node(&ctx->arena, EMPTY_TOKEN, 0, -1, NULL);
+            if (empty_key == NULL)
+                return sampler_failed(ctx);
             return empty_key;
         }
     }
 }
 
-RuleNode* rules_get_def(Rule* rule, Grammar* grammar, size_t l_str)
+RuleNode* rules_get_def(SamplerContext* ctx, Rule* rule, size_t l_str)
 {
     if (rule->num_tokens == 0) 
         return NULL;
+
+    // Rules from outside the token pool are neither memoized nor bounded.
+    size_t pos;
+    int memoized = rule_pool_pos(rule, ctx->grammar, &pos);
+    const LengthBounds* bounds = &ctx->length_bounds;
+    if (memoized && (l_str < bounds->suffix_min[pos]
+                     || l_str > bounds->suffix_max[pos]))
+        return NULL;
     
     RuleNode* memoized_result;
-    if ((memoized_result = get_rule(&rule_strs, rule, l_str)) != NULL)
+    if (memoized && (memoized_result = get_rule(&ctx->rule_strs, pos, l_str)) != NULL)
         return memoized_result;
 
-    // The head is the first non-empty token.
-    Token head = EMPTY_TOKEN;
-    size_t head_index;
-    for (head_index = 0; head_index < rule->num_tokens; head_index++)
-    {
-        if (rule->tokens[head_index] != EMPTY_TOKEN)
-        {
-            head = rule->tokens[head_index];
-            break;
-        }
-    }
-    if (head == EMPTY_TOKEN) return NULL;
+    // The head is the first token of the rule, and the tail is a view of
+    // the remaining tokens in the grammar's token pool.
+    Token head = rule->tokens[0];
 
-    // If the head is the last token in the array, then there is no tail.
-    if (head_index == rule->num_tokens - 1)
+    // If the head is the last token in the rule, then there is no tail.
+    if (rule->num_tokens == 1)
     {
-        KeyNode* s_ = key_get_def(head, grammar, l_str);
-        if (s_->count == -1) 
+        KeyNode* s_ = key_get_def(ctx, head, l_str);
+        if (s_ == NULL || s_->count == -1) 
             return NULL;
 
-        RuleNode* rn = create_rule_node(s_, NULL, l_str, s_->count);
+        RuleNode* rn = create_rule_node(&ctx->arena, s_, NULL, l_str, s_->count);
+        if (rn == NULL)
+            return sampler_failed(ctx);
+        if (memoized)
+            insert_rule(&ctx->rule_strs, pos, l_str, rn);
         return rn;
     }
 
-    // Create a new rule with head_index set to EMPTY_TOKEN.
-    Rule* rule_copy = malloc(sizeof(Rule));
-    rule_copy->num_tokens = rule->num_tokens;
-    for (size_t i = 0; i < rule->num_tokens; i++)
+    Rule tail = {rule->num_tokens - 1, rule->tokens + 1};
+
+    // Only try the partitions for which both the head and the tail can
+    // derive a string of the required length.
+    size_t min_partition = 1;
+    size_t max_partition = l_str;
+    if (memoized)
     {
-        rule_copy->tokens[i] = rule->tokens[i];
+        size_t head_min = key_min_length(bounds, head);
+        size_t head_max = key_max_length(bounds, head);
+        size_t tail_min = bounds->suffix_min[pos + 1];
+        size_t tail_max = bounds->suffix_max[pos + 1];
+
+        if (head_min > min_partition)
+            min_partition = head_min;
+        if (tail_max < l_str && l_str - tail_max > min_partition)
+            min_partition = l_str - tail_max;
+        if (head_max < max_partition)
+            max_partition = head_max;
+        if (l_str - tail_min < max_partition)
+            max_partition = l_str - tail_min;
     }
-    rule_copy->tokens[head_index] = EMPTY_TOKEN;
 
     RuleNode* sum_rule = NULL; // List of RuleNodes
-    for (size_t partition = 1; partition <= l_str; partition++)
+    for (size_t partition = min_partition; partition <= max_partition; partition++)
     {
         size_t h_len = partition;
         size_t t_len = l_str - partition;
 
-        KeyNode* s_in_h = key_get_def(head, grammar, h_len);
+        KeyNode* s_in_h = key_get_def(ctx, head, h_len);
+        if (s_in_h == NULL)
+            return NULL;
         if (s_in_h->count == -1) 
             continue;
 
-        RuleNode* s_in_t = rules_get_def(rule_copy, grammar, t_len);
+        RuleNode* s_in_t = rules_get_def(ctx, &tail, t_len);
+        if (ctx->failed)
+            return NULL;
         if (s_in_t == NULL) 
             continue;
 
@@ -133,7 +229,9 @@ RuleNode* rules_get_def(Rule* rule, Grammar* grammar, size_t l_str)
             continue;
 
         // Create a new RuleNode for the current partition.
-        RuleNode* rn = create_rule_node(s_in_h, s_in_t, partition, count);
+        RuleNode* rn = create_rule_node(&ctx->arena, s_in_h, s_in_t, partition, count);
+        if (rn == NULL)
+            return sampler_failed(ctx);
 
         // Append rn to the linked list
         if (sum_rule == NULL)
@@ -152,8 +250,8 @@ RuleNode* rules_get_def(Rule* rule, Grammar* grammar, size_t l_str)
     }
 
     // Memoize.
-    if (sum_rule != NULL)
-        insert_rule(&rule_strs, rule_copy, l_str, sum_rule);
+    if (memoized && sum_rule != NULL)
+        insert_rule(&ctx->rule_strs, pos, l_str, sum_rule);
 
     return sum_rule;
 }
@@ -324,12 +422,15 @@ DynTokenArray* rule_get_string_at(RuleNode* rn, int at)
     return NULL;
 }
 
-DynTokenArray* string_sample_UAR(Token key, Grammar* grammar, size_t l_str)
+DynTokenArray* string_sample_UAR(SamplerContext* ctx, Token key, size_t l_str,
+    Rng* rng)
 {
 
-    KeyNode* kn = key_get_def(key, grammar, l_str);
+    KeyNode* kn = key_get_def(ctx, key, l_str);
+    if (kn == NULL || kn->count <= 0)
+        return NULL;
     
-    int at = rand() % kn->count;
+    int at = rng_bounded(rng, kn->count);
     printf("Extracting string from random index %d\n", at);
     
     DynTokenArray* string = key_get_string_at(kn, at);